@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "piece.h"
+#include "search.h"
+#include "timeman.h"
+
+using namespace std;
+
+#define AB_INFINITY 32000
+#define AB_MATE 30000
+#define AB_MAX_PLY 128
+
+// 置换表项标志
+enum BoundType {
+    BOUND_NONE,
+    BOUND_UPPER, // 不超过该值
+    BOUND_LOWER, // 不低于该值
+    BOUND_EXACT
+};
+
+// 多线程共享的置换表，key 与 data 异或存储以检测并发写入造成的撕裂
+class TranspositionTable {
+public:
+    TranspositionTable(int sizeMB = 64);
+
+    void Clear();
+
+    // 命中返回 true，score 已按 ply 还原杀棋分数
+    bool Probe(uint64_t key, int ply, uint16_t& move, int& score, int& depth, BoundType& bound) const;
+    void Store(uint64_t key, int ply, uint16_t move, int score, int depth, BoundType bound);
+
+private:
+    struct Entry {
+        atomic<uint64_t> key;
+        atomic<uint64_t> data;
+    };
+    vector<Entry> entries;
+    uint64_t mask;
+};
+
+// 迭代加深 alpha-beta 搜索
+// PVS + 置换表 + 空着裁剪 + 杀手/历史启发 + 静态搜索，多线程采用 Lazy SMP
+class AlphaBetaAI : public SearchEngine {
+public:
+    AlphaBetaAI(const ChessBoard& board, Color player, int hashSizeMB = 64);
+
+    void Search(const SearchLimits& limits) override;
+    pair<pair<int, int>, pair<int, int>> GetBestMove() override;
+    void Update(pair<pair<int, int>, pair<int, int>> move) override;
+    void Reset(const ChessBoard& board, Color player) override;
+    void Stop() override;
+    SearchProgress GetProgress() const override;
+
+    // 最近一次搜索的结果
+    int GetScore() const;
+    int GetDepth() const;
+    uint64_t GetNodes() const;
+
+    // 静态评估，相对 player
+    static int Evaluate(const ChessBoard& board, Color player);
+
+    // 单个棋子的静态价值，advance 为离己方底线的距离
+    static int PieceValue(PieceType type, int advance, int col);
+
+private:
+    // 每个线程独立的搜索状态
+    struct Worker {
+        int id;
+        ChessBoard board;
+        vector<uint64_t> path; // 对局及搜索路径上的局面哈希
+        uint16_t killers[AB_MAX_PLY][2];
+        int historyTable[90][90];
+        uint64_t nodes;
+        uint16_t rootMove;  // 当前迭代根节点最佳走法
+        uint16_t bestMove;  // 最近一次完成迭代的结果
+        int bestScore;
+        int completedDepth;
+    };
+
+    ChessBoard board;
+    Color player;
+    vector<uint64_t> gamePath; // 最近一次不可逆走法之后的对局局面哈希
+    TranspositionTable table;
+    atomic<bool> stop;
+    atomic<uint64_t> totalNodes; // 搜索中每 1024 个节点累加一次，结束后为准确值
+    atomic<int> searchDepth;     // 主线程已完成的深度
+    chrono::steady_clock::time_point deadline;
+    uint16_t bestMove;
+    int bestScore;
+    int bestDepth;
+
+    void IterativeDeepening(Worker& worker, int maxDepth);
+    int Negamax(Worker& worker, int depth, int alpha, int beta, int ply, Color side, bool allowNull);
+    int Quiescence(Worker& worker, int alpha, int beta, int ply, Color side);
+    void OrderMoves(Worker& worker, vector<pair<pair<int, int>, pair<int, int>>>& moves, uint16_t ttMove, int ply) const;
+    bool CheckStop(Worker& worker);
+    bool IsRepetition(const Worker& worker) const;
+    static bool KingsFacing(const ChessBoard& board);
+};
\ No newline at end of file
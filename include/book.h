@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "piece.h"
+#include "mcts.h"
+#include "record.h"
+
+using namespace std;
+
+// 开局库文件格式：
+//   BookFileHeader
+//   BookEntry entries[entryCount]，按 (key, move) 升序排列
+// 查询时通过 mmap 映射文件，对 key 二分查找，无需加载整个文件
+
+#define BOOK_FILE_MAGIC "CCOB"
+#define BOOK_FILE_VERSION 1
+
+#pragma pack(push, 1)
+struct BookFileHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t entryCount;
+    uint32_t reserved2;
+};
+
+struct BookEntry {
+    uint64_t key;    // 局面哈希（包含行棋方）
+    uint16_t move;   // 16 位走法编码
+    uint16_t weight; // 权重
+};
+#pragma pack(pop)
+
+// 开局库
+class OpeningBook {
+public:
+    OpeningBook();
+    ~OpeningBook();
+
+    bool Open(const string& path);
+    void Close();
+    bool IsOpen() const;
+    size_t EntryCount() const;
+
+    // 获取当前局面的所有库内走法及权重
+    vector<pair<pair<pair<int, int>, pair<int, int>>, int>> GetMoves(const ChessBoard& board, Color player) const;
+
+    // 按权重随机选择库内走法，未命中返回 false
+    bool Probe(const ChessBoard& board, Color player, pair<pair<int, int>, pair<int, int>>& move) const;
+
+private:
+    const uint8_t* data;
+    size_t size;
+    const BookEntry* entries;
+    uint32_t entryCount;
+};
+
+// 开局库生成器
+class OpeningBookBuilder {
+public:
+    OpeningBookBuilder(int maxPly = 20);
+
+    // 添加一个局面的走法
+    void AddMove(const ChessBoard& board, Color player, const pair<pair<int, int>, pair<int, int>>& move, int weight);
+
+    // 添加一局棋的前 maxPly 步，胜方走法权重 2，和棋 1，负方不计入
+    void AddGame(const vector<pair<pair<int, int>, pair<int, int>>>& moves, GameResult result);
+
+    // 添加记录文件中的所有对局
+    void AddRecordFile(const GameRecordFile& file);
+
+    // 自我对弈生成开局，每步按访问次数为根节点各走法加权
+    // seed 非 0 时以确定性方式搜索，第 i 局使用 seed + i
+    void SelfPlay(int games, int iterations, int threadNum = 10, unsigned seed = 0);
+
+    // 合并相同走法并写入文件，过滤权重低于 minWeight 的走法
+    bool Write(const string& path, int minWeight = 1);
+
+private:
+    int maxPly;
+    vector<BookEntry> entries;
+};
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "piece.h"
+
+using namespace std;
+
+// 评估请求：输入局面与合法走法，输出行棋方视角的价值与各走法的先验概率
+struct EvalRequest {
+    const ChessBoard* board;
+    Color player;
+    const vector<pair<pair<int, int>, pair<int, int>>>* moves;
+    vector<float> priors; // 与 moves 一一对应
+    float value;          // [-1, 1]，相对 player
+    bool done;
+};
+
+// 局面评估接口
+class Evaluator {
+public:
+    virtual ~Evaluator() {}
+
+    // 批量评估，结果写回每个请求
+    virtual void EvaluateBatch(EvalRequest* const* requests, int count) = 0;
+
+    // 评估单个局面
+    virtual void Evaluate(EvalRequest& request);
+};
+
+// 多线程批量评估：各搜索线程提交请求后等待，
+// 凑满 batchSize 或等待超过 timeoutUs 时由当前线程统一执行一批
+class BatchedEvaluator : public Evaluator {
+public:
+    // 接管 inner 的所有权
+    BatchedEvaluator(Evaluator* inner, int batchSize = 8, int timeoutUs = 200);
+    ~BatchedEvaluator();
+
+    void EvaluateBatch(EvalRequest* const* requests, int count) override;
+    void Evaluate(EvalRequest& request) override;
+
+    // 统计：已执行批次数与请求数
+    uint64_t GetBatchCount() const;
+    uint64_t GetRequestCount() const;
+
+private:
+    Evaluator* inner;
+    int batchSize;
+    int timeoutUs;
+    mutex mtx;
+    condition_variable cv;
+    vector<EvalRequest*> pending;
+    uint64_t batchCount;
+    uint64_t requestCount;
+
+    void RunBatch(unique_lock<mutex>& lock);
+};
+
+#define NETWORK_FILE_MAGIC "CCNN"
+#define NETWORK_INPUTS (14 * BOARD_HEIGHT * BOARD_WIDTH) // 己方/对方 7 种棋子 x 90 格
+#define NETWORK_POLICY (2 * BOARD_HEIGHT * BOARD_WIDTH)  // 起点 90 格 + 终点 90 格
+
+// 策略/价值网络，仅使用 CPU
+// 输入为行棋方视角的棋子-格子稀疏特征，两层全连接后分别输出走法起点/终点得分与局面价值
+class PolicyValueNet : public Evaluator {
+public:
+    PolicyValueNet(int hidden1 = 128, int hidden2 = 64);
+
+    // 固定种子随机初始化
+    void Initialize(uint32_t seed = 1);
+
+    bool Load(const string& path);
+    bool Save(const string& path) const;
+
+    void EvaluateBatch(EvalRequest* const* requests, int count) override;
+
+private:
+    int hidden1;
+    int hidden2;
+    vector<float> inputWeights;  // NETWORK_INPUTS x hidden1
+    vector<float> inputBias;     // hidden1
+    vector<float> hiddenWeights; // hidden1 x hidden2
+    vector<float> hiddenBias;    // hidden2
+    vector<float> policyWeights; // hidden2 x NETWORK_POLICY
+    vector<float> policyBias;    // NETWORK_POLICY
+    vector<float> valueWeights;  // hidden2
+    float valueBias;
+
+    // 行棋方视角下的格子编号，黑方上下翻转
+    static int PerspectiveSquare(int row, int col, Color player);
+};
+
+// 全连接层：out[b][o] = bias[o] + sum_i in[b][i] * weights[i][o]，按 CPU 支持选择 AVX2 或标量实现
+void DenseForward(const float* in, int batch, int inputs, const float* weights, const float* bias, int outputs, float* out);
\ No newline at end of file
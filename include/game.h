@@ -1,6 +1,59 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "piece.h"
 #include "mcts.h"
+#include "record.h"
+#include "book.h"
+#include "search.h"
+#include "alphabeta.h"
+
+// 对局配置
+struct GameConfig {
+    EngineType engine = ENGINE_MCTS; // 搜索引擎
+    Color aiColor = RED;             // AI 执子颜色
+    SearchLimits limits;             // 每步搜索限制
+    int hashSizeMB = 64;             // alpha-beta 置换表大小（MB）
+    int progressMs = 1000;           // 搜索进度输出间隔（毫秒），0 表示不输出
+    int clockMs = 0;                 // AI 一方的对局用时（毫秒），0 表示按 limits 固定搜索
+    int incrementMs = 0;             // 每步加秒（毫秒）
+    unsigned seed = 0;               // 搜索随机种子，0 表示按当前时间
+};
+
+// 对局事件
+enum GameEventType {
+    EVENT_INPUT,        // 一行用户输入
+    EVENT_INPUT_CLOSED, // 输入结束
+    EVENT_SEARCH_DONE   // 搜索任务结束
+};
+
+struct GameEvent {
+    GameEventType type;
+    string text; // EVENT_INPUT 的输入内容
+    int search;  // EVENT_SEARCH_DONE 对应的搜索编号
+};
+
+// 线程安全的事件队列，输入线程与搜索任务向对局主循环投递事件
+class GameEventQueue {
+public:
+    void Post(const GameEvent& event);
+
+    // 等待事件，timeoutMs 小于 0 时一直等待，超时返回 false
+    bool Wait(GameEvent& event, int timeoutMs);
+
+private:
+    mutex mtx;
+    condition_variable cv;
+    deque<GameEvent> events;
+};
+
+// 按输入格式输出走法，如 b2-e2
+string FormatMove(const pair<pair<int, int>, pair<int, int>>& move);
 
 // 游戏管理类
 class ChessGame {
@@ -8,15 +61,61 @@ class ChessGame {
         
         Color currentPlayer;
         Color aiColor;
+        vector<pair<pair<int, int>, pair<int, int>>> moveHistory; // 对局走法记录
+        GameRecordWriter* recorder; // 每步搜索后写入搜索树，对局结束时写入走法记录（可为空）
+        const OpeningBook* book; // 搜索前查询的开局库（可为空）
+        PositionHistory history; // 局面历史，用于判断重复局面
+        GameConfig config;
+        shared_ptr<GameEventQueue> events; // 输入线程可能比对局存活更久，共享所有权
+        bool inputStarted;
+        thread searchTask;                 // 后台搜索任务
+        atomic<bool> searchFinished;
+        bool searching;
+        bool stopRequested;                // 已请求停止，搜索结束后仍然走子
+        int searchId;                      // 用于丢弃已取消搜索的结束事件
+        chrono::steady_clock::time_point searchStart;
+        int clockMs;                       // AI 一方剩余时间
         
     public:
         ChessBoard *board;
-        MCTSAI ai;
-        ChessGame(ChessBoard *board, MCTSAI& ai);
+        SearchEngine* engine; // 按配置创建的搜索引擎
+        ChessGame(ChessBoard *board, const GameConfig& config = GameConfig());
         ~ChessGame();
     
+        // 事件循环：搜索在后台执行，期间仍可处理输入
+        // 命令：stop 让 AI 立即走子，resign 认输，new 重新开局，quit 退出
         void Start();
+
+        // 设置对局记录输出
+        void SetRecorder(GameRecordWriter* recorder);
+
+        // 设置开局库
+        void SetOpeningBook(const OpeningBook* book);
     
     private:
+        // 按配置创建搜索引擎
+        static SearchEngine* CreateEngine(const GameConfig& config, const ChessBoard& board, Color player);
+
         vector<pair<int, int>> ParseInput(const string& input);
+
+        // 启动读取标准输入的线程
+        void StartInput();
+
+        // 在后台开始搜索，结束后投递 EVENT_SEARCH_DONE
+        void StartSearch();
+
+        // 停止搜索并等待任务结束，不使用搜索结果
+        void CancelSearch();
+
+        // 走子并同步引擎与局面历史，非法走法返回 false
+        bool PlayMove(pair<pair<int, int>, pair<int, int>> move, GameResult& result);
+
+        // 走出引擎给出的走法，走法非法时改走一个合法走法，没有合法走法时返回 false
+        bool PlayEngineMove(pair<pair<int, int>, pair<int, int>> move, GameResult& result);
+
+        // 重新开局
+        void NewGame();
+
+        // 对局结束时写入记录并输出结果
+        void Finish(GameResult result);
     };
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "piece.h"
+
+using namespace std;
+
+// 历史局面记录
+struct HistoryEntry {
+    uint64_t hash; // 走子后局面哈希（包含行棋方）
+    pair<pair<int, int>, pair<int, int>> move; // 到达该局面的走法
+};
+
+// 局面历史栈，用于判断重复局面
+// 吃子或兵卒前进后局面不可能再重复，此时清空之前的记录，只保留可逆走法部分
+class PositionHistory {
+public:
+    PositionHistory();
+
+    void Clear();
+    size_t Size() const;
+
+    // 记录初始局面
+    void Reset(const ChessBoard& board, Color currentPlayer);
+
+    // 记录走子后的局面，before 为走子前的棋盘
+    void Push(const ChessBoard& before, const ChessBoard& after, Color currentPlayer,
+              const pair<pair<int, int>, pair<int, int>>& move);
+
+    // 记录走子后的局面，irreversible 表示吃子或兵卒前进
+    void Push(uint64_t hash, const pair<pair<int, int>, pair<int, int>>& move, bool irreversible);
+
+    // 当前局面此前出现次数达到 repeats 时按亚洲规则判定结果：
+    // 单方长将判负，单方长捉判负，其余情况判和；未重复返回 NOT_OVER
+    GameResult CheckRepetition(const ChessBoard& board, int repeats = 1) const;
+
+    // 判断走法是否不可逆
+    static bool IsIrreversible(const ChessBoard& before, const pair<pair<int, int>, pair<int, int>>& move);
+
+    // 判断走法是否为捉子：走子后新攻击到对方无根子，或以马、炮攻击对方车
+    static bool IsChase(const ChessBoard& before, const ChessBoard& after,
+                        const pair<pair<int, int>, pair<int, int>>& move);
+
+private:
+    vector<HistoryEntry> entries;
+};
\ No newline at end of file
@@ -5,27 +5,51 @@
 #include <cmath>
 #include <ctime>
 #include <cstdlib>
+#include <climits>
 #include <algorithm>
 #include <mutex>
+#include <shared_mutex>
 #include <atomic>
 #include <thread>
+#include <chrono>
+#include <condition_variable>
 #include "piece.h"
+#include "tablebase.h"
+#include "history.h"
+#include "search.h"
+#include "timeman.h"
+#include "evaluator.h"
+#include "nnue.h"
 
 using namespace std;
 
 
+// 一个节点全部子节点的统计量，按结构数组连续存放，选择子节点时只顺序扫描这些数组
+// 多线程下以 __atomic 内建函数更新，SIMD 扫描允许读到略旧的值
+struct ChildStats {
+    vector<int32_t> visits;    // 访问次数
+    vector<float> totalScore;  // 总得分，相对走入子节点的一方
+    vector<float> virtualLoss; // 虚拟损失
+    vector<float> prior;       // 策略网络给出的先验概率
+    vector<uint16_t> moves;    // 走法，与 EncodeMove 编码相同
+};
+
 // MCTS 节点定义
 class MCTSNode {
 public:
     ChessBoard board; // 当前棋盘状态
     Color currentPlayer; // 当前玩家
     MCTSNode* parent; // 父节点
+    int index; // 在父节点 stats 中的下标
     vector<MCTSNode*> children; // 子节点
-    atomic<int> visitCount; // 访问次数
-    atomic<double> totalScore; // 总得分
-    atomic<double> virtualLoss; //虚拟损失
+    ChildStats stats; // 子节点统计量，与 children 一一对应
     mutex mtx;
+    atomic<bool> expanded; // 已添加子节点，IsLeaf 不加锁读取
+    uint32_t lastVisit; // 最近一次经过该节点的模拟序号，回收搜索树时按此淘汰
     pair<pair<int, int>, pair<int, int>> lastMove; // 记录最后移动
+    static const EndgameTablebase* tablebase; // 残局库（可为空）
+    static const NNUEEvaluator* nnue; // 模拟截断时使用的评估（可为空）
+    static int playoutCutoff; // 设置 nnue 时模拟的最大步数
 
     MCTSNode(const ChessBoard& board, Color currentPlayer, MCTSNode* parent = nullptr);
 
@@ -37,17 +61,35 @@ public:
     // 判断是否为根节点
     bool IsRoot() const;
 
-    // 计算 UCB1 值
-    double UCB1(double explorationWeight = 1.414) const;
+    // 节点统计量，非根节点存放在父节点的 stats 中
+    int VisitCount() const;
+    double TotalScore() const;
+    float Prior() const;
+    void SetStats(int visits, double totalScore);
+
+    // 脱离父节点成为根节点，统计量复制到节点自身
+    void Detach();
+
+    // 选择最佳子节点，usePUCT 为 true 时按先验概率选择
+    // UCB1 与 PUCT 对全部子节点按 SIMD 宽度批量计算
+    MCTSNode* SelectBestChild(bool usePUCT = false);
 
-    // 选择最佳子节点
-    MCTSNode* SelectBestChild();
+    // 扩展子节点，返回新建的节点数
+    int Expand();
 
-    // 扩展子节点
-    void Expand();
+    // 按给定走法与先验概率扩展子节点，返回新建的节点数
+    int Expand(const vector<pair<pair<int, int>, pair<int, int>>>& moves, const vector<float>& priors);
 
-    // 随机模拟游戏
-    double Simulate();
+    // 删除全部子节点使本节点重新成为叶子，子树的统计量已累计在本节点中，返回删除的节点数
+    // 调用方需保证没有其他线程访问该子树
+    size_t Collapse();
+
+    // 追加一个子节点，调用方负责加锁
+    MCTSNode* AddChild(const pair<pair<int, int>, pair<int, int>>& move, float prior);
+
+    // 随机模拟游戏，history 为到达该节点的局面历史，模拟过程中会继续压入
+    // 设置 nnue 时模拟 playoutCutoff 步后以增量评估结果截断
+    double Simulate(PositionHistory& history);
 
     // 回溯更新节点
     void Backpropagate(double score);
@@ -61,19 +103,41 @@ public:
     // 评估棋盘状态
     static double EvaluateBoard(GameResult result, Color player);
 
+    // 查询残局库，未命中返回 NOT_OVER
+    static GameResult ProbeTablebase(const ChessBoard& board, Color currentPlayer);
+
+    // 子节点选择使用的指令集，默认按 CPU 支持情况选择
+    static NNUESimd GetSelectSimd();
+    static bool SetSelectSimd(NNUESimd simd);
+
+    // 设置调用线程模拟使用的随机数种子，stream 区分同一种子下的不同线程
+    // 未设置时各线程按 random_device 初始化
+    static void SeedRandom(unsigned seed, unsigned stream = 0);
+
     // 打印节点对应棋盘
     void Print();
 
 private:
+    // 根节点自身的统计量
+    int32_t rootVisits;
+    float rootScore;
+    float rootVirtualLoss;
+
+    // 统计量所在位置
+    int32_t* VisitSlot();
+    float* ScoreSlot();
+    float* VirtualLossSlot();
+
     // 生成合法移动
     vector<pair<pair<int, int>, pair<int, int>>> GenerateLegalMoves(const ChessBoard& board, Color player);
     
 };
 
 // MCTS AI
-class MCTSAI {
+class MCTSAI : public SearchEngine {
 public:
     MCTSNode* root;
+    PositionHistory history; // 对局开始到根节点的局面历史
 
     MCTSAI();
     MCTSAI(const ChessBoard board, Color player);
@@ -85,20 +149,92 @@ public:
     void Run(int iterations);
     void ParallelRun(int iterations, int threadNum = 10);
 
+    // 按时间管理搜索，直到 timer 判断应当结束
+    void TimedRun(TimeManager& timer, int threadNum = 10);
+
+    // 按搜索限制运行 ParallelRun，设置对局时钟时运行 TimedRun
+    void Search(const SearchLimits& limits) override;
+    void Stop() override;
+    SearchProgress GetProgress() const override;
+
+    // 搜索树节点数上限，0 表示不限制
+    // 达到上限时暂停搜索线程，把最久未经过的子树收缩为叶子，直到节点数降到上限的 3/4
+    // 仍无法回收时叶子不再展开
+    void SetNodeLimit(size_t limit);
+    size_t GetNodeCount() const;
+
+    // 获取当前搜索结果，可在搜索线程运行时调用，maxDepth 为主要变例的最大长度
+    SearchSnapshot GetSnapshot(int maxDepth = 16) const;
+
+    // ParallelRun 期间每 intervalMs 毫秒以快照调用 callback，搜索结束时再调用一次
+    // callback 返回 false 时提前结束搜索，可用于局面已稳定时节省计算
+    void SetSnapshotCallback(SnapshotCallback callback, int intervalMs = 1000);
+
+    // 非 0 时 ParallelRun 以确定性方式运行：各线程使用固定种子，0 号线程搜索主树，
+    // 其余线程各自搜索独立的树，结束后按线程顺序合并统计量
+    // 相同的种子、线程数与模拟次数总是得到相同的搜索树，设置评估器时要求评估器本身是确定的；
+    // 按时钟搜索或中途停止时不保证
+    void SetSeed(unsigned seed);
+
+    // 外部替换 root 后重新统计节点数
+    void RecountNodes();
+
+    // 设置叶子评估器（不接管所有权，可为空）
+    // useValueHead 为 true 时以价值头代替随机模拟，否则仅使用策略先验
+    void SetEvaluator(Evaluator* evaluator, bool useValueHead = true);
+
 
     // 选择最佳移动
-    pair<pair<int, int>, pair<int, int>> GetBestMove();
+    pair<pair<int, int>, pair<int, int>> GetBestMove() override;
 
     // 自动更新节点
     void AutoUpdate();
 
-    // 手动更新节点
-    void Update(pair<pair<int, int>, pair<int, int>> move);
+    // 手动更新节点，走法不在搜索树中时以走子后的局面新建根节点
+    void Update(pair<pair<int, int>, pair<int, int>> move) override;
+
+    // 以新局面重建搜索树
+    void Reset(const ChessBoard& board, Color player) override;
 
 private:
+    Evaluator* evaluator; // 叶子评估器
+    bool useValueHead;
+    atomic<size_t> nodeCount; // 当前搜索树节点数
+    size_t nodeLimit;
+    atomic<bool> stopping; // Run 每次模拟前检查，Search 开始时清除
+    SnapshotCallback snapshotCallback;
+    int snapshotIntervalMs;
+    unsigned seed; // 确定性搜索的种子，0 表示不启用
+    atomic<uint32_t> visitClock; // 主树的模拟序号，写入 MCTSNode::lastVisit
+    // 每次模拟与读取快照时共享持有，回收搜索树时独占持有
+    mutable shared_mutex treeMtx;
+
+    // 统计子树节点数
+    static size_t CountNodes(const MCTSNode* node);
+
+    // 加锁读取访问次数最多的子节点与子节点访问总数，没有子节点时返回 nullptr
+    static MCTSNode* MostVisitedChild(MCTSNode* node, int& totalVisits, int* secondVisits = nullptr);
+
+    // 启动 threadNum 个线程各运行 threadIterations 次模拟，等待期间报告快照并检查用时
+    void RunThreads(int threadIterations, int threadNum, TimeManager* timer);
+
+    // 在以 tree 为根的树上运行 iterations 次模拟，count 为该树的节点数，clock 为该树的模拟序号，limit 为节点数上限
+    void RunTree(MCTSNode* tree, int iterations, atomic<size_t>& count, atomic<uint32_t>& clock, size_t limit);
+
+    // 节点数达到 limit 时按最近经过的顺序从旧到新收缩子树，节点数降到 limit 的 3/4 为止
+    void CollectTree(MCTSNode* tree, atomic<size_t>& count, size_t limit);
+
+    // 把 src 的统计量按子节点顺序累加到 dst，dst 缺少的子节点按 src 的走法与先验补全
+    static void MergeTree(MCTSNode* dst, const MCTSNode* src);
+
+    // 选择节点，沿途记录模拟序号 tick
+    MCTSNode* Select(MCTSNode* node, uint32_t tick);
+
+    // 使用评估器展开叶子，返回 true 表示 score 已由价值头给出
+    bool EvaluateLeaf(MCTSNode* node, double& score, atomic<size_t>& count);
 
-    // 选择节点
-    MCTSNode* Select(MCTSNode* node);
+    // 生成从对局开始到 node 的局面历史
+    PositionHistory BuildPath(MCTSNode* node);
 
 };
 
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "piece.h"
+
+using namespace std;
+
+#define BATCH_LANES 16 // 每组同时处理的局面数，与 SSE2 寄存器宽度一致
+
+// 批量走法生成结果，按 CSR 格式存放：第 i 个局面的走法为 moves[offsets[i], offsets[i + 1])
+struct MoveBatch {
+    vector<uint32_t> offsets;
+    vector<uint16_t> moves; // 与 EncodeMove 编码相同
+
+    size_t Count(size_t index) const;
+    const uint16_t* Moves(size_t index) const;
+};
+
+// 结构数组布局的局面批：同一格子在所有局面中的棋子编码连续存放，
+// 走法规则按格子逐个判断，每次对 BATCH_LANES 个局面同时计算
+class BoardBatch {
+public:
+    BoardBatch();
+
+    void Clear();
+    void Reserve(size_t count);
+
+    // 添加局面，返回其编号
+    size_t Add(const ChessBoard& board, Color player);
+    size_t Size() const;
+
+    // square 格在所有局面中的棋子编码（type | color << 4）
+    const uint8_t* Square(int square) const;
+    Color Player(size_t index) const;
+
+    // 统计每个局面的走法数，threadNum 为 0 时使用全部核心
+    void CountMoves(vector<uint32_t>& counts, int threadNum = 0) const;
+
+    // 生成所有局面的走法，与 ChessBoard::GenerateMoves 结果相同，仅顺序不同
+    void GenerateMoves(MoveBatch& out, int threadNum = 0) const;
+
+private:
+    size_t count;
+    size_t capacity;         // BATCH_LANES 的整数倍
+    vector<uint8_t> squares; // 90 x capacity
+    vector<uint8_t> players; // capacity
+
+    // 扫描从 begin 开始的一组局面，对每个 (起点, 终点) 以车道掩码调用 emit
+    template <class Emit>
+    void ScanBlock(size_t begin, Emit& emit) const;
+
+    // 把 blocks 组局面分给多个线程处理
+    static void ParallelFor(size_t blocks, int threadNum, const function<void(size_t, size_t)>& body);
+};
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "piece.h"
+#include "evaluator.h"
+
+using namespace std;
+
+#define NNUE_FILE_MAGIC "CCNU"
+#define NNUE_FILE_VERSION 1
+#define NNUE_BUCKETS 9                                              // 己方将帅在九宫中的 9 个位置
+#define NNUE_PIECE_FEATURES (14 * BOARD_HEIGHT * BOARD_WIDTH)       // 己方/对方 7 种棋子 x 90 格
+#define NNUE_FEATURES (NNUE_BUCKETS * NNUE_PIECE_FEATURES)
+#define NNUE_HIDDEN 128                                             // 每个视角的累加器宽度
+#define NNUE_CLIP 1023                                              // 截断 ReLU 上限
+#define NNUE_OUTPUT_SCALE 4                                         // 输出层结果除以该值得到分数
+#define NNUE_VALUE_SCALE 400.0f                                     // 分数映射到 [-1, 1] 时 tanh(1) 对应的分数
+
+// SIMD 指令集
+enum NNUESimd {
+    NNUE_SCALAR,
+    NNUE_SSE41,
+    NNUE_AVX2
+};
+
+// 双视角特征累加器，按 Color - 1 索引
+struct NNUEAccumulator {
+    int16_t values[2][NNUE_HIDDEN];
+    int kingBucket[2];
+};
+
+// NNUE 风格评估：特征为（己方将帅位置, 棋子, 格子），第一层按走法增量更新
+// 未加载权重文件时第一层首个神经元按 AlphaBetaAI::PieceValue 初始化，输出即子力位置分
+class NNUEEvaluator : public Evaluator {
+public:
+    NNUEEvaluator();
+
+    // 按静态子力价值初始化
+    void Initialize();
+
+    bool Load(const string& path);
+    bool Save(const string& path) const;
+
+    // 全量计算累加器
+    void Refresh(NNUEAccumulator& acc, const ChessBoard& board) const;
+
+    // 走子后增量更新累加器，board 为走子后的局面，moved 为移动的棋子，captured 为被吃的棋子
+    void ApplyMove(NNUEAccumulator& acc, const ChessBoard& board, int fromRow, int fromCol, int toRow, int toCol,
+                   const ChessPiece& moved, const ChessPiece& captured) const;
+
+    // 由累加器计算评估分数，相对 player
+    int Evaluate(const NNUEAccumulator& acc, Color player) const;
+
+    // 全量计算评估分数，相对 player
+    int Evaluate(const ChessBoard& board, Color player) const;
+
+    // 评估分数映射到 [-1, 1]，相对 player
+    float Value(const NNUEAccumulator& acc, Color player) const;
+
+    // 作为 MCTS 叶子评估器：价值由分数映射到 [-1, 1]，先验为均匀分布
+    void EvaluateBatch(EvalRequest* const* requests, int count) override;
+
+    // 运行时选择的指令集，SetSimd 在 CPU 不支持时返回 false
+    static NNUESimd GetSimd();
+    static bool SetSimd(NNUESimd simd);
+    static bool IsSupported(NNUESimd simd);
+    static const char* SimdName(NNUESimd simd);
+
+private:
+    vector<int16_t> featureWeights; // NNUE_FEATURES x NNUE_HIDDEN
+    vector<int16_t> featureBias;    // NNUE_HIDDEN
+    vector<int16_t> outputWeights;  // 行棋方 NNUE_HIDDEN + 对方 NNUE_HIDDEN
+    int32_t outputBias;
+
+    void RefreshPerspective(NNUEAccumulator& acc, const ChessBoard& board, Color perspective) const;
+
+    // 己方将帅位置编号，找不到时返回 0
+    static int KingBucket(const ChessBoard& board, Color perspective);
+
+    // 特征编号
+    static int FeatureIndex(Color perspective, int bucket, const ChessPiece& piece, int row, int col);
+};
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string>
 #include <map>
 #include <algorithm>
+#include <cstdint>
 
 #define BOARD_WIDTH 9
 #define BOARD_HEIGHT 10
@@ -33,7 +34,7 @@ enum Color {
 struct ChessPiece {
     PieceType type;
     Color color;
-    string symbol; // Unicode符号
+    const char* symbol; // Unicode符号，指向 PIECE_SYMBOLS
 };
 
 enum GameResult {
@@ -47,7 +48,7 @@ enum GameResult {
 class ChessBoard {
 private:
     vector<vector<ChessPiece>> board;
-    map<pair<int, int>, string> positionSymbols;
+    uint64_t hashKey; // Zobrist 哈希（不含行棋方）
 
 public:
     string name;
@@ -55,36 +56,37 @@ public:
     ChessBoard(string name);
     ~ChessBoard();
     void InitializeBoard();
+    void Clear();
     void SetPiece(int row, int col, PieceType type, Color color);
     const ChessPiece* GetPiece(int row, int col) const;
-    string GetSymbol(PieceType type, Color color);
+    static const char* GetSymbol(PieceType type, Color color);
     void Print(bool reverse =false);
     bool MovePiece(int fromRow, int fromCol, int toRow, int toCol);
+    // 不检查合法性的走子与撤销，供搜索使用
+    ChessPiece MakeMove(int fromRow, int fromCol, int toRow, int toCol);
+    void UnmakeMove(int fromRow, int fromCol, int toRow, int toCol, const ChessPiece& captured);
     bool IsValidMove(int fromRow, int fromCol, int toRow, int toCol) const;
-    void InitializeSymbols();
+    // 判断 color 方将/帅是否被将军（包括将帅照面）
+    bool IsInCheck(Color color) const;
+    // 生成 player 的所有合法移动
+    vector<pair<pair<int, int>, pair<int, int>>> GenerateMoves(Color player) const;
     static GameResult IsGameOver(const ChessBoard& board, Color currentPlayer);
+    // 获取局面哈希（包含行棋方）
+    uint64_t GetHash(Color player) const;
 
 
 private:
-    // 将/帅移动规则
-    bool ValidateKingMove(int fromRow, int fromCol, int toRow, int toCol, Color color) const;
+    // Zobrist 随机数
+    static const vector<uint64_t>& ZobristTable();
+    static uint64_t ZobristKey(PieceType type, Color color, int row, int col);
 
-    // 士移动规则
-    bool ValidateAdvisorMove(int fromRow, int fromCol, int toRow, int toCol, Color color) const;
-
-    // 马移动规则
-    bool ValidateHorseMove(int fromRow, int fromCol, int dx, int dy) const;
-
-    // 象移动规则
-    bool ValidateElephantMove(int fromRow, int fromCol, int toRow, int toCol, Color color) const;
+    // 将帅、士、象、马、兵卒按走法目标表判断
+    bool ValidateStepMove(int fromRow, int fromCol, int toRow, int toCol, PieceType type, Color color) const;
 
     // 车移动规则
     bool ValidateRookMove(int fromRow, int fromCol, int toRow, int toCol) const;
 
     // 炮移动规则
     bool ValidateCannonMove(int fromRow, int fromCol, int toRow, int toCol) const;
-
-    // 兵/卒移动规则
-    bool ValidatePawnMove(int fromRow, int fromCol, int toRow, int toCol, Color color) const;
 };
 
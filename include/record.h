@@ -0,0 +1,151 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "piece.h"
+#include "mcts.h"
+
+using namespace std;
+
+// 对局记录 / 搜索树快照的二进制格式
+//
+// 文件结构：
+//   RecordFileHeader
+//   记录 0: RecordHeader + 数据
+//   记录 1: RecordHeader + 数据
+//   ...
+//   索引: uint64_t offsets[recordCount]
+//   RecordFileFooter
+//
+// 记录按顺序流式写入，关闭时在文件末尾追加索引，
+// 读取时通过 mmap 映射文件，根据索引直接定位任意一条记录而无需解析整个文件。
+
+#define RECORD_FILE_MAGIC "CCRF"
+#define RECORD_FOOTER_MAGIC "CCRE"
+#define RECORD_FILE_VERSION 2
+
+// 记录类型
+enum RecordType {
+    RECORD_GAME = 1,  // 对局走法序列
+    RECORD_TREE = 2   // 搜索树快照
+};
+
+#pragma pack(push, 1)
+struct RecordFileHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+};
+
+struct RecordHeader {
+    uint8_t type;      // RecordType
+    uint8_t reserved;
+    uint16_t reserved2;
+    uint32_t size;     // 数据部分字节数
+};
+
+// 对局记录：result + moveCount + moves[moveCount]
+struct GameRecordHeader {
+    uint8_t result;    // GameResult
+    uint8_t reserved;
+    uint16_t moveCount;
+};
+
+// 搜索树记录：根局面 + nodeCount + 先序排列的节点
+struct TreeRecordHeader {
+    uint8_t board[BOARD_HEIGHT * BOARD_WIDTH]; // 每格: type | color << 4
+    uint8_t player;    // 根节点行棋方
+    uint8_t reserved;
+    uint32_t nodeCount;
+};
+
+struct TreeNodeRecord {
+    uint16_t move;       // 到达该节点的走法（根节点为 0）
+    uint16_t childCount; // 已保存的子节点数（先序紧随其后）
+    uint32_t visits;
+    float totalScore;
+    float prior;         // 策略先验概率
+};
+
+struct RecordFileFooter {
+    uint64_t indexOffset;
+    uint32_t recordCount;
+    char magic[4];
+};
+#pragma pack(pop)
+
+// 16 位走法编码：低 7 位为起点格子 (row * 9 + col)，高位 7 位为终点格子
+uint16_t EncodeMove(const pair<pair<int, int>, pair<int, int>>& move);
+pair<pair<int, int>, pair<int, int>> DecodeMove(uint16_t code);
+
+// 走法编码的起点与终点都在棋盘内，读取文件中的走法前须先检查
+bool IsValidMoveCode(uint16_t code);
+
+// 流式写入对局记录与搜索树快照
+class GameRecordWriter {
+public:
+    GameRecordWriter();
+    ~GameRecordWriter();
+
+    bool Open(const string& path);
+    void Close();
+    bool IsOpen() const;
+
+    // 写入一局棋的走法序列
+    bool WriteGame(const vector<pair<pair<int, int>, pair<int, int>>>& moves, GameResult result);
+
+    // 写入以 root 为根的搜索树，只展开访问次数不少于 minVisits 的节点
+    bool WriteTree(MCTSNode* root, int minVisits = 1, int maxDepth = 64);
+
+private:
+    ofstream out;
+    uint64_t offset;
+    vector<uint64_t> index;
+
+    void BeginRecord(RecordType type, uint32_t size);
+    void WriteBytes(const void* data, size_t size);
+    void CollectNodes(MCTSNode* node, uint16_t move, int minVisits, int depth, vector<TreeNodeRecord>& nodes);
+};
+
+// 对局记录的零拷贝视图，指针直接指向映射内存
+struct GameRecordView {
+    GameResult result;
+    uint16_t moveCount;
+    const uint16_t* moves;
+};
+
+// 通过 mmap 读取记录文件
+class GameRecordFile {
+public:
+    GameRecordFile();
+    ~GameRecordFile();
+
+    bool Open(const string& path);
+    void Close();
+
+    size_t RecordCount() const;
+    RecordType GetType(size_t i) const;
+
+    // 获取对局记录视图
+    bool GetGame(size_t i, GameRecordView& view) const;
+
+    // 解码对局走法
+    bool ReadGame(size_t i, vector<pair<pair<int, int>, pair<int, int>>>& moves, GameResult& result) const;
+
+    // 重建搜索树并替换 ai 的根节点，用于热启动
+    // 只接受根局面与行棋方都和 ai 当前根节点相同的搜索树，节点走法须合法且不重复，
+    // 已展开节点须包含全部合法走法，否则保留原根节点并返回 false
+    bool LoadTree(size_t i, MCTSAI& ai) const;
+
+private:
+    const uint8_t* data;
+    size_t size;
+    const uint64_t* index;
+    uint32_t recordCount;
+
+    const RecordHeader* GetHeader(size_t i) const;
+
+    // 按先序重建以 root 为根的节点，出现非法、重复或不完整的走法时返回 false
+    static bool BuildTree(MCTSNode* root, const TreeNodeRecord* nodes, uint32_t nodeCount);
+};
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "piece.h"
+
+using namespace std;
+
+// 搜索引擎类型
+enum EngineType {
+    ENGINE_MCTS,      // 蒙特卡洛树搜索
+    ENGINE_ALPHABETA  // 迭代加深 alpha-beta 搜索
+};
+
+// 搜索限制
+struct SearchLimits {
+    int iterations = 4000; // MCTS 模拟次数
+    int threadNum = 10;    // 搜索线程数
+    int depth = 64;        // alpha-beta 最大深度
+    int timeMs = 5000;     // alpha-beta 时间限制（毫秒）
+    int clockMs = 0;       // 对局剩余时间（毫秒），大于 0 时由 TimeManager 分配本步用时
+    int incrementMs = 0;   // 每步加秒（毫秒）
+    unsigned seed = 0;     // MCTS 确定性搜索的种子，0 表示不启用
+};
+
+// 搜索进度，可在搜索过程中从其他线程读取
+struct SearchProgress {
+    uint64_t nodes = 0; // 已搜索节点数，MCTS 为根节点访问次数
+    int depth = 0;      // 已完成的迭代深度，MCTS 为 0
+};
+
+// 搜索过程中的根节点统计快照
+struct SearchSnapshot {
+    pair<pair<int, int>, pair<int, int>> bestMove; // 访问次数最多的根节点子节点
+    int visits = 0;         // 根节点访问次数
+    double share = 0;       // 最佳走法占根节点子节点总访问次数的比例
+    double secondShare = 0; // 次佳走法的访问比例
+    double value = 0;       // 最佳走法的平均得分，相对根节点行棋方，范围 [-1, 1]
+    vector<pair<pair<int, int>, pair<int, int>>> pv; // 沿访问次数最多的子节点得到的主要变例
+};
+
+// 快照回调，返回 false 时停止搜索
+typedef function<bool(const SearchSnapshot&)> SnapshotCallback;
+
+// 搜索引擎接口
+class SearchEngine {
+public:
+    virtual ~SearchEngine() {}
+
+    // 搜索当前根局面
+    virtual void Search(const SearchLimits& limits) = 0;
+
+    // 获取最佳移动
+    virtual pair<pair<int, int>, pair<int, int>> GetBestMove() = 0;
+
+    // 对局走子后同步根局面
+    virtual void Update(pair<pair<int, int>, pair<int, int>> move) = 0;
+
+    // 重新开始对局，丢弃之前的搜索结果
+    virtual void Reset(const ChessBoard& board, Color player) = 0;
+
+    // 请求正在进行的搜索尽快返回，可在其他线程调用
+    // 搜索开始时会清除停止请求，调用方须在搜索结束前重复请求
+    virtual void Stop() = 0;
+
+    // 当前搜索进度，可在其他线程调用
+    virtual SearchProgress GetProgress() const = 0;
+};
\ No newline at end of file
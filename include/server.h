@@ -0,0 +1,96 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "piece.h"
+#include "mcts.h"
+
+using namespace std;
+
+// 会话调度策略
+enum SchedulePolicy {
+    SCHEDULE_FAIR,     // 各会话平均分配模拟次数
+    SCHEDULE_PRIORITY, // 按优先级加权分配
+    SCHEDULE_DEADLINE  // 截止时间最早的会话优先
+};
+
+// 会话配置
+struct SessionConfig {
+    int priority = 1;        // 优先级，SCHEDULE_PRIORITY 下按比例分配
+    int playouts = 4000;     // 每步模拟次数
+    int deadlineMs = 0;      // 每步时间上限（毫秒），0 表示不限制
+    size_t maxNodes = 200000; // 搜索树节点数上限
+};
+
+// 多对局引擎服务：所有会话共享固定数量的工作线程，
+// 每个工作线程每次从调度器取一个会话的一段模拟（slice）执行
+class EngineServer {
+public:
+    EngineServer(int workerNum = 0, SchedulePolicy policy = SCHEDULE_FAIR, int sliceSize = 64);
+    ~EngineServer();
+
+    // 创建会话，返回会话编号
+    int CreateSession(const SessionConfig& config);
+    bool CloseSession(int id);
+
+    // 会话中走一步（对手走法），非法走法或会话忙时返回 false
+    bool Play(int id, pair<pair<int, int>, pair<int, int>> move);
+
+    // 为会话当前行棋方开始搜索，完成后自动走子并调用 onMove
+    bool Go(int id);
+
+    // 搜索完成回调，在工作线程中调用
+    void SetMoveCallback(function<void(int, pair<pair<int, int>, pair<int, int>>, GameResult)> callback);
+
+    // 会话统计
+    bool GetStats(int id, size_t& nodes, int& playouts, Color& player) const;
+    vector<int> SessionIds() const;
+
+    // 文本协议：new/play/go/close/stats/quit，见 server.cpp，playouts 为 new 命令的默认模拟次数
+    void Serve(istream& in, ostream& out, int playouts = 4000);
+
+private:
+    struct Session {
+        int id;
+        SessionConfig config;
+        ChessBoard board;
+        Color player;
+        MCTSAI ai;
+        bool searching;
+        bool closing;
+        int issued;    // 已分配的模拟次数
+        int completed; // 已完成的模拟次数
+        int running;   // 正在执行的 slice 数
+        double pass;   // 步幅调度的累计值
+        chrono::steady_clock::time_point deadline;
+
+        Session(int id, const SessionConfig& config);
+    };
+
+    SchedulePolicy policy;
+    int sliceSize;
+    mutable mutex mtx;
+    condition_variable cv;
+    map<int, unique_ptr<Session>> sessions;
+    vector<thread> workers;
+    bool stopping;
+    int nextId;
+    function<void(int, pair<pair<int, int>, pair<int, int>>, GameResult)> onMove;
+
+    void WorkerLoop();
+
+    // 选择下一个可分配 slice 的会话，须持有锁
+    Session* PickSession(chrono::steady_clock::time_point now);
+
+    // 会话是否还能继续分配 slice
+    static bool HasBudget(const Session& session, chrono::steady_clock::time_point now);
+
+    // 搜索结束后走子，须持有锁，返回是否完成
+    bool Finish(Session& session, pair<pair<int, int>, pair<int, int>>& move, GameResult& result);
+};
\ No newline at end of file
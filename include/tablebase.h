@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "piece.h"
+
+using namespace std;
+
+// 残局库文件格式：
+//   TablebaseFileHeader
+//   uint8_t values[entryCount]
+// 每个局面一个字节：0 表示和棋，255 表示非法局面，
+// 其余为 dtm + 1，dtm 为距离吃掉对方将帅的步数（半回合），奇数为行棋方胜，偶数为行棋方负
+
+#define TABLEBASE_FILE_MAGIC "CCTB"
+#define TABLEBASE_FILE_VERSION 1
+#define TABLEBASE_MAX_PIECES 8
+#define TABLEBASE_DRAW 0
+#define TABLEBASE_ILLEGAL 255
+
+#pragma pack(push, 1)
+struct TablebaseFileHeader {
+    char magic[4];
+    uint16_t version;
+    uint8_t pieceCount;
+    uint8_t reserved;
+    uint8_t pieces[TABLEBASE_MAX_PIECES]; // 每个棋子: type | color << 4
+    uint64_t entryCount;
+};
+#pragma pack(pop)
+
+// 查询结果（相对行棋方）
+struct TablebaseResult {
+    int wdl; // 1 胜，0 和，-1 负
+    int dtm; // 距离终局的半回合数
+};
+
+class EndgameTablebase;
+
+// 单个子力组合的残局表，例如 "KRK"（红方将帅+车 对 黑方将帅）
+class EndgameTable {
+public:
+    EndgameTable();
+    ~EndgameTable();
+
+    // 子力签名，红方在前，每方以 K 开头
+    const string& GetSignature() const;
+
+    // 逆向分析生成全部局面，吃子后的局面查询 tablebase 中已有的子表
+    bool Generate(const string& signature, const EndgameTablebase& tablebase);
+
+    bool Write(const string& path) const;
+    bool Open(const string& path);
+    void Close();
+
+    // 查询局面，mirror 为真时先将棋盘上下翻转并交换双方颜色
+    bool Probe(const ChessBoard& board, Color player, bool mirror, TablebaseResult& result) const;
+
+    // 由签名计算子力列表，非法签名返回 false
+    static bool ParseSignature(const string& signature, vector<pair<PieceType, Color>>& pieces);
+    static string MakeSignature(const vector<pair<PieceType, Color>>& pieces);
+
+private:
+    string signature;
+    vector<pair<PieceType, Color>> pieces;
+    vector<vector<int>> domains;     // 每个棋子可能所在的格子
+    vector<vector<int>> squareIndex; // 格子 -> 在 domains 中的序号，不可达为 -1
+    uint64_t entryCount;
+
+    vector<uint8_t> ownedValues; // 生成的表
+    const uint8_t* mappedData;   // mmap 映射的文件
+    size_t mappedSize;
+    const uint8_t* values;
+
+    void Setup(const vector<pair<PieceType, Color>>& pieces);
+    uint64_t Index(const vector<int>& squares, Color player) const;
+    void Decode(uint64_t index, vector<int>& squares, Color& player) const;
+};
+
+// 残局库：按子力签名管理多张残局表
+class EndgameTablebase {
+public:
+    EndgameTablebase();
+    ~EndgameTablebase();
+
+    // 生成签名对应的残局表，以及吃子后可能到达的所有子表
+    bool Generate(const string& signature);
+
+    // 保存全部残局表到目录
+    bool Save(const string& dir) const;
+
+    // 加载目录下的全部 .cctb 文件
+    int Load(const string& dir);
+
+    size_t TableCount() const;
+    int MaxPieces() const;
+
+    // 查询局面，未收录的子力组合返回 false
+    bool Probe(const ChessBoard& board, Color player, TablebaseResult& result) const;
+
+private:
+    map<string, EndgameTable*> tables;
+    int maxPieces;
+
+    void AddTable(EndgameTable* table);
+};
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "piece.h"
+
+using namespace std;
+
+// 编译期生成的走子规则与符号表，运行时只读
+
+#define BOARD_SQUARES (BOARD_WIDTH * BOARD_HEIGHT)
+#define NO_SQUARE 0xFF
+
+// 单个格子上某种棋子的走法目标，block 为须为空的格子（马腿/象眼），不需要时为 NO_SQUARE
+struct StepTargets {
+    uint8_t count;
+    uint8_t to[8];
+    uint8_t block[8];
+};
+
+// 车炮沿四个方向依次经过的格子
+struct RayTargets {
+    uint8_t length[4];
+    uint8_t squares[4][BOARD_HEIGHT];
+};
+
+constexpr bool OnBoard(int row, int col) {
+    return row >= 0 && row < BOARD_HEIGHT && col >= 0 && col < BOARD_WIDTH;
+}
+
+// 是否在 color 方九宫内
+constexpr bool InPalace(Color color, int row, int col) {
+    if (col < 3 || col > 5) return false;
+    if (color == RED) return row >= 0 && row <= 2;
+    if (color == BLACK) return row >= 7 && row <= 9;
+    return false;
+}
+
+// 是否在 color 方河界一侧
+constexpr bool OnOwnSide(Color color, int row) {
+    return color == RED ? row <= 4 : row >= 5;
+}
+
+// 生成 type/color 棋子在 square 格的走法目标
+template <PieceType type, Color color>
+constexpr StepTargets MakeStepTargets(int square) {
+    StepTargets targets{};
+    int row = square / BOARD_WIDTH;
+    int col = square % BOARD_WIDTH;
+    auto add = [&targets](int toRow, int toCol, int blockRow, int blockCol) {
+        targets.to[targets.count] = toRow * BOARD_WIDTH + toCol;
+        targets.block[targets.count] = blockRow < 0 ? NO_SQUARE : blockRow * BOARD_WIDTH + blockCol;
+        targets.count++;
+    };
+    const int steps[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    const int diagonals[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    if constexpr (type == KING) {
+        for (const auto& step : steps) {
+            if (InPalace(color, row + step[0], col + step[1])) add(row + step[0], col + step[1], -1, -1);
+        }
+    } else if constexpr (type == ADVISOR) {
+        for (const auto& step : diagonals) {
+            if (InPalace(color, row + step[0], col + step[1])) add(row + step[0], col + step[1], -1, -1);
+        }
+    } else if constexpr (type == ELEPHANT) {
+        // 象走田字，象眼为中点，不能过河
+        for (const auto& step : diagonals) {
+            int toRow = row + 2 * step[0], toCol = col + 2 * step[1];
+            if (OnBoard(toRow, toCol) && OnOwnSide(color, toRow)) add(toRow, toCol, row + step[0], col + step[1]);
+        }
+    } else if constexpr (type == HORSE) {
+        // 马走日字，马腿为长边方向相邻的格子
+        const int horseSteps[8][2] = {{1, 2}, {1, -2}, {-1, 2}, {-1, -2}, {2, 1}, {2, -1}, {-2, 1}, {-2, -1}};
+        for (const auto& step : horseSteps) {
+            int toRow = row + step[0], toCol = col + step[1];
+            if (OnBoard(toRow, toCol)) add(toRow, toCol, row + step[0] / 2, col + step[1] / 2);
+        }
+    } else if constexpr (type == PAWN) {
+        // 兵卒向前一步，过河后可横走
+        int forward = color == RED ? 1 : -1;
+        if (OnBoard(row + forward, col)) add(row + forward, col, -1, -1);
+        if (!OnOwnSide(color, row)) {
+            if (col > 0) add(row, col - 1, -1, -1);
+            if (col < BOARD_WIDTH - 1) add(row, col + 1, -1, -1);
+        }
+    }
+    return targets;
+}
+
+// 按棋子类型与颜色特化的走法目标表
+template <PieceType type, Color color>
+struct StepTable {
+    static constexpr array<StepTargets, BOARD_SQUARES> squares = [] {
+        array<StepTargets, BOARD_SQUARES> table{};
+        for (int square = 0; square < BOARD_SQUARES; ++square) table[square] = MakeStepTargets<type, color>(square);
+        return table;
+    }();
+};
+
+#define STEP_TABLE_ROW(type) {&StepTable<type, NONE>::squares, &StepTable<type, RED>::squares, &StepTable<type, BLACK>::squares}
+
+// 按 [type][color] 索引的走法目标表，车炮与空格无目标
+constexpr const array<StepTargets, BOARD_SQUARES>* STEP_TABLES[8][3] = {
+    STEP_TABLE_ROW(EMPTY), STEP_TABLE_ROW(KING), STEP_TABLE_ROW(ADVISOR), STEP_TABLE_ROW(ELEPHANT),
+    STEP_TABLE_ROW(HORSE), STEP_TABLE_ROW(ROOK), STEP_TABLE_ROW(CANNON), STEP_TABLE_ROW(PAWN)
+};
+
+#undef STEP_TABLE_ROW
+
+constexpr const StepTargets& GetStepTargets(PieceType type, Color color, int square) {
+    return (*STEP_TABLES[type][color])[square];
+}
+
+// 车炮射线表，方向顺序为上、下、右、左
+constexpr array<RayTargets, BOARD_SQUARES> RAY_TABLE = [] {
+    array<RayTargets, BOARD_SQUARES> table{};
+    const int steps[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    for (int square = 0; square < BOARD_SQUARES; ++square) {
+        for (int dir = 0; dir < 4; ++dir) {
+            int row = square / BOARD_WIDTH + steps[dir][0];
+            int col = square % BOARD_WIDTH + steps[dir][1];
+            for (; OnBoard(row, col); row += steps[dir][0], col += steps[dir][1]) {
+                table[square].squares[dir][table[square].length[dir]++] = row * BOARD_WIDTH + col;
+            }
+        }
+    }
+    return table;
+}();
+
+// 棋子符号，按 [color][type] 索引
+constexpr const char* PIECE_SYMBOLS[3][8] = {
+    {" ", " ", " ", " ", " ", " ", " ", " "},
+    {" ", "帥", "仕", "相", "傌", "俥", "炮", "兵"},
+    {" ", "將", "士", "象", "馬", "車", "砲", "卒"}
+};
+
+// 空格子显示符号：河界、九宫与普通格子
+constexpr array<const char*, BOARD_SQUARES> SQUARE_SYMBOLS = [] {
+    array<const char*, BOARD_SQUARES> table{};
+    for (int square = 0; square < BOARD_SQUARES; ++square) {
+        int row = square / BOARD_WIDTH, col = square % BOARD_WIDTH;
+        if (row == 4 || row == 5) table[square] = "～";
+        else if (InPalace(RED, row, col) || InPalace(BLACK, row, col)) table[square] = "＋";
+        else table[square] = "  ";
+    }
+    return table;
+}();
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include <chrono>
+#include "search.h"
+
+using namespace std;
+
+// 按对局时钟分配每步用时
+// 基础用时按剩余时间平均分配，最佳与次佳走法接近或最佳走法较晚改变时延长，
+// 最佳走法占绝对优势或剩余时间内无法被超越时提前结束
+class TimeManager {
+public:
+    // clockMs 为剩余时间，movesToGo 为到下一次加时的步数，0 表示按剩余 30 步估计
+    TimeManager(int clockMs, int incrementMs = 0, int movesToGo = 0);
+
+    int BaseMs() const;
+    int MaximumMs() const;
+    int ElapsedMs() const;
+
+    // 根据搜索快照判断是否继续搜索，搜索期间定期调用
+    bool ShouldContinue(const SearchSnapshot& snapshot);
+
+private:
+    chrono::steady_clock::time_point start;
+    int baseMs;
+    int maximumMs;
+    int startVisits; // 第一次调用时根节点已有的访问次数（来自复用的子树）
+    pair<pair<int, int>, pair<int, int>> lastBest;
+    int lastChangeMs; // 最佳走法最后一次改变的时间
+    bool started;
+};
\ No newline at end of file
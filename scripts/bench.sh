@@ -0,0 +1,59 @@
+#!/bin/sh
+# 依次构建各优化配置并比较速度：固定种子自我对弈 + 各项基准测试，输出相对 Debug 的加速比
+# lto 只开启链接时优化，native 在其基础上再按本机指令集编译，两者的收益分别报告
+# 用法：scripts/bench.sh [自我对弈局数] [每步模拟次数]
+set -e
+cd "$(dirname "$0")/.."
+GAMES=${1:-2}
+PLAYOUTS=${2:-2000}
+JOBS=$(nproc 2>/dev/null || echo 1)
+RESULTS=$(mktemp)
+trap 'rm -f "$RESULTS"' EXIT
+
+now() {
+    date +%s.%N
+}
+
+# 运行一项测试并记录耗时（秒）
+measure() {
+    name=$1
+    shift
+    start=$(now)
+    "$@" >/dev/null </dev/null
+    end=$(now)
+    echo "$name $start $end" | awk '{ printf "%s %.3f\n", $1, $3 - $2 }'
+}
+
+# 固定种子的工作负载，与 PGO 训练一致
+workload() {
+    exe=$1
+    dir=$(dirname "$exe")
+    measure selfplay "$exe" --build-book "$dir/bench-book.bin" --selfplay "$GAMES" --playouts "$PLAYOUTS" --threads 2 --seed 1
+    measure nnue "$exe" --bench-nnue 20
+    measure movegen "$exe" --bench-movegen 200
+    measure select "$exe" --bench-select 1000000
+}
+
+for preset in debug release lto native; do
+    cmake --preset "$preset" >/dev/null
+    cmake --build --preset "$preset" -j"$JOBS" >/dev/null
+    workload "build/$preset/ChineseChess" | sed "s/^/$preset /" >>"$RESULTS"
+done
+
+# PGO：生成剖析数据后在同一构建目录中重新编译
+cmake --preset pgo-generate >/dev/null
+cmake --build --preset pgo-train -j"$JOBS" >/dev/null
+cmake --preset pgo-use >/dev/null
+cmake --build --preset pgo-use -j"$JOBS" >/dev/null
+workload build/pgo/ChineseChess | sed "s/^/pgo /" >>"$RESULTS"
+
+printf "%-8s %-8s %10s %8s\n" 配置 测试 秒 加速比
+awk '
+    $1 == "debug" { base[$2] = $3 }
+    { rows[NR] = $0 }
+    END {
+        for (i = 1; i <= NR; ++i) {
+            split(rows[i], f, " ")
+            printf "%-8s %-8s %10.3f %7.2fx\n", f[1], f[2], f[3], base[f[2]] / f[3]
+        }
+    }' "$RESULTS"
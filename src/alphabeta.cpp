@@ -0,0 +1,397 @@
+#include "alphabeta.h"
+#include <thread>
+#include <cstring>
+#include "record.h"
+#include "history.h"
+
+// 棋子价值
+static const int PIECE_VALUES[8] = {0, 0, 120, 120, 270, 600, 285, 30};
+
+TranspositionTable::TranspositionTable(int sizeMB) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= (size_t)sizeMB * 1024 * 1024) count *= 2;
+    entries = vector<Entry>(count);
+    mask = count - 1;
+    Clear();
+}
+
+void TranspositionTable::Clear() {
+    for (auto& entry : entries) {
+        entry.key.store(0, memory_order_relaxed);
+        entry.data.store(0, memory_order_relaxed);
+    }
+}
+
+bool TranspositionTable::Probe(uint64_t key, int ply, uint16_t& move, int& score, int& depth, BoundType& bound) const {
+    const Entry& entry = entries[key & mask];
+    uint64_t data = entry.data.load(memory_order_relaxed);
+    if ((entry.key.load(memory_order_relaxed) ^ data) != key) return false;
+    move = data & 0xFFFF;
+    score = (int16_t)((data >> 16) & 0xFFFF);
+    depth = (data >> 32) & 0xFF;
+    bound = (BoundType)((data >> 40) & 0x3);
+    // 杀棋分数按当前层数还原
+    if (score > AB_MATE - AB_MAX_PLY) score -= ply;
+    else if (score < -AB_MATE + AB_MAX_PLY) score += ply;
+    return bound != BOUND_NONE;
+}
+
+void TranspositionTable::Store(uint64_t key, int ply, uint16_t move, int score, int depth, BoundType bound) {
+    Entry& entry = entries[key & mask];
+    uint64_t old = entry.data.load(memory_order_relaxed);
+    bool sameKey = (entry.key.load(memory_order_relaxed) ^ old) == key;
+    // 同一局面保留更深的结果，不同局面直接替换
+    if (sameKey && depth < (int)((old >> 32) & 0xFF) && bound != BOUND_EXACT) return;
+    if (sameKey && move == 0) move = old & 0xFFFF;
+    if (score > AB_MATE - AB_MAX_PLY) score += ply;
+    else if (score < -AB_MATE + AB_MAX_PLY) score -= ply;
+    uint64_t data = move | ((uint64_t)(uint16_t)score << 16) | ((uint64_t)(uint8_t)depth << 32) | ((uint64_t)bound << 40);
+    entry.key.store(key ^ data, memory_order_relaxed);
+    entry.data.store(data, memory_order_relaxed);
+}
+
+AlphaBetaAI::AlphaBetaAI(const ChessBoard& board, Color player, int hashSizeMB) : table(hashSizeMB) {
+    this->board = board;
+    this->player = player;
+    gamePath.push_back(board.GetHash(player));
+    stop.store(false);
+    totalNodes.store(0);
+    searchDepth.store(0);
+    bestMove = 0;
+    bestScore = 0;
+    bestDepth = 0;
+}
+
+// 单个棋子的子力价值加位置分，advance 为离己方底线的距离
+int AlphaBetaAI::PieceValue(PieceType type, int advance, int col) {
+    int center = 4 - abs(col - 4);
+    int value = PIECE_VALUES[type];
+    switch (type) {
+        case PAWN:
+            if (advance >= 5) value += 40 + (advance - 5) * 5 + (center >= 3 ? 10 : 0);
+            break;
+        case HORSE:
+            value += center * 4 + min(advance, 6) * 4;
+            break;
+        case CANNON:
+            value += (col == 4 ? 10 : 0) + (advance >= 5 ? 5 : 0);
+            break;
+        case ROOK:
+            value += (advance >= 5 ? 20 : 0) + center * 2;
+            break;
+        default:
+            break;
+    }
+    return value;
+}
+
+// 静态评估：子力价值加简单的位置分
+int AlphaBetaAI::Evaluate(const ChessBoard& board, Color player) {
+    int score = 0;
+    for (int row = 0; row < BOARD_HEIGHT; ++row) {
+        for (int col = 0; col < BOARD_WIDTH; ++col) {
+            const ChessPiece* piece = board.GetPiece(row, col);
+            if (piece->type == EMPTY) continue;
+            int advance = (piece->color == RED) ? row : BOARD_HEIGHT - 1 - row; // 离己方底线的距离
+            int value = PieceValue(piece->type, advance, col);
+            score += (piece->color == player) ? value : -value;
+        }
+    }
+    return score;
+}
+
+// 将帅照面
+bool AlphaBetaAI::KingsFacing(const ChessBoard& board) {
+    int redRow = -1, blackRow = -1, col = -1;
+    for (int c = 3; c <= 5; ++c) {
+        for (int row = 0; row <= 2; ++row) {
+            if (board.GetPiece(row, c)->type == KING) redRow = row, col = c;
+        }
+    }
+    if (redRow < 0) return false;
+    for (int row = 7; row <= 9; ++row) {
+        if (board.GetPiece(row, col)->type == KING) blackRow = row;
+    }
+    if (blackRow < 0) return false;
+    for (int row = redRow + 1; row < blackRow; ++row) {
+        if (board.GetPiece(row, col)->type != EMPTY) return false;
+    }
+    return true;
+}
+
+bool AlphaBetaAI::CheckStop(Worker& worker) {
+    if ((worker.nodes & 1023) == 0) {
+        totalNodes.fetch_add(1024, memory_order_relaxed);
+        if (chrono::steady_clock::now() >= deadline) stop.store(true);
+    }
+    return stop.load(memory_order_relaxed);
+}
+
+// 路径上同一行棋方的局面重复
+bool AlphaBetaAI::IsRepetition(const Worker& worker) const {
+    int n = worker.path.size();
+    for (int k = n - 5; k >= 0; k -= 2) {
+        if (worker.path[k] == worker.path[n - 1]) return true;
+    }
+    return false;
+}
+
+// 走法排序：置换表走法 > 吃子（MVV-LVA）> 杀手走法 > 历史启发
+void AlphaBetaAI::OrderMoves(Worker& worker, vector<pair<pair<int, int>, pair<int, int>>>& moves, uint16_t ttMove, int ply) const {
+    vector<pair<int, pair<pair<int, int>, pair<int, int>>>> scored;
+    scored.reserve(moves.size());
+    for (const auto& move : moves) {
+        uint16_t code = EncodeMove(move);
+        const ChessPiece* victim = worker.board.GetPiece(move.second.first, move.second.second);
+        const ChessPiece* attacker = worker.board.GetPiece(move.first.first, move.first.second);
+        int score;
+        if (code == ttMove) score = 1000000;
+        else if (victim->type != EMPTY) score = 500000 + PIECE_VALUES[victim->type] * 10 - PIECE_VALUES[attacker->type] / 10;
+        else if (code == worker.killers[ply][0]) score = 400000;
+        else if (code == worker.killers[ply][1]) score = 390000;
+        else score = worker.historyTable[code & 0x7F][code >> 7];
+        scored.push_back({score, move});
+    }
+    stable_sort(scored.begin(), scored.end(), [](const pair<int, pair<pair<int, int>, pair<int, int>>>& a,
+                                                 const pair<int, pair<pair<int, int>, pair<int, int>>>& b) {
+        return a.first > b.first;
+    });
+    for (size_t i = 0; i < moves.size(); ++i) moves[i] = scored[i].second;
+}
+
+// 静态搜索：只搜索吃子走法
+int AlphaBetaAI::Quiescence(Worker& worker, int alpha, int beta, int ply, Color side) {
+    worker.nodes++;
+    if (CheckStop(worker)) return 0;
+    if (KingsFacing(worker.board)) return AB_MATE - ply;
+
+    int standPat = Evaluate(worker.board, side);
+    if (standPat >= beta || ply >= AB_MAX_PLY - 1) return standPat;
+    if (standPat > alpha) alpha = standPat;
+
+    vector<pair<pair<int, int>, pair<int, int>>> captures;
+    for (const auto& move : worker.board.GenerateMoves(side)) {
+        const ChessPiece* target = worker.board.GetPiece(move.second.first, move.second.second);
+        if (target->type == KING) return AB_MATE - ply;
+        if (target->type != EMPTY) captures.push_back(move);
+    }
+    OrderMoves(worker, captures, 0, ply);
+
+    Color opponent = (side == RED) ? BLACK : RED;
+    for (const auto& move : captures) {
+        ChessPiece captured = worker.board.MakeMove(move.first.first, move.first.second, move.second.first, move.second.second);
+        int score = -Quiescence(worker, -beta, -alpha, ply + 1, opponent);
+        worker.board.UnmakeMove(move.first.first, move.first.second, move.second.first, move.second.second, captured);
+        if (stop.load(memory_order_relaxed)) return 0;
+        if (score >= beta) return score;
+        if (score > alpha) alpha = score;
+    }
+    return alpha;
+}
+
+// 主变搜索
+int AlphaBetaAI::Negamax(Worker& worker, int depth, int alpha, int beta, int ply, Color side, bool allowNull) {
+    worker.nodes++;
+    if (CheckStop(worker)) return 0;
+    if (KingsFacing(worker.board)) return AB_MATE - ply;
+    if (ply > 0 && IsRepetition(worker)) return 0;
+    if (depth <= 0 || ply >= AB_MAX_PLY - 1) return Quiescence(worker, alpha, beta, ply, side);
+
+    bool pvNode = beta - alpha > 1;
+    uint64_t key = worker.board.GetHash(side);
+    uint16_t ttMove = 0;
+    int ttScore, ttDepth;
+    BoundType ttBound;
+    if (table.Probe(key, ply, ttMove, ttScore, ttDepth, ttBound) && !pvNode && ply > 0 && ttDepth >= depth) {
+        if (ttBound == BOUND_EXACT) return ttScore;
+        if (ttBound == BOUND_LOWER && ttScore >= beta) return ttScore;
+        if (ttBound == BOUND_UPPER && ttScore <= alpha) return ttScore;
+    }
+
+    vector<pair<pair<int, int>, pair<int, int>>> moves = worker.board.GenerateMoves(side);
+    if (moves.empty()) return -(AB_MATE - ply); // 困毙
+    for (const auto& move : moves) {
+        if (worker.board.GetPiece(move.second.first, move.second.second)->type == KING) return AB_MATE - ply;
+    }
+
+    Color opponent = (side == RED) ? BLACK : RED;
+    bool inCheck = worker.board.IsInCheck(side);
+    if (inCheck) depth++; // 将军延伸
+
+    // 空着裁剪：己方有车马炮时让对方连走一步仍不低于 beta 则剪枝
+    if (allowNull && !pvNode && !inCheck && depth >= 3 && Evaluate(worker.board, side) >= beta) {
+        bool hasMajor = false;
+        for (int row = 0; row < BOARD_HEIGHT && !hasMajor; ++row) {
+            for (int col = 0; col < BOARD_WIDTH; ++col) {
+                const ChessPiece* piece = worker.board.GetPiece(row, col);
+                if (piece->color == side && (piece->type == ROOK || piece->type == HORSE || piece->type == CANNON)) {
+                    hasMajor = true;
+                    break;
+                }
+            }
+        }
+        if (hasMajor) {
+            worker.path.push_back(worker.board.GetHash(opponent));
+            int score = -Negamax(worker, depth - 3, -beta, -beta + 1, ply + 1, opponent, false);
+            worker.path.pop_back();
+            if (stop.load(memory_order_relaxed)) return 0;
+            if (score >= beta && score < AB_MATE - AB_MAX_PLY) return beta;
+        }
+    }
+
+    OrderMoves(worker, moves, ttMove, ply);
+    int bestScore = -AB_INFINITY;
+    uint16_t best = 0;
+    int originalAlpha = alpha;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        const auto& move = moves[i];
+        bool quiet = worker.board.GetPiece(move.second.first, move.second.second)->type == EMPTY;
+        ChessPiece captured = worker.board.MakeMove(move.first.first, move.first.second, move.second.first, move.second.second);
+        worker.path.push_back(worker.board.GetHash(opponent));
+        int score;
+        if (i == 0) {
+            score = -Negamax(worker, depth - 1, -beta, -alpha, ply + 1, opponent, true);
+        } else {
+            // 零窗口试探，失败高时再用完整窗口重搜
+            score = -Negamax(worker, depth - 1, -alpha - 1, -alpha, ply + 1, opponent, true);
+            if (score > alpha && score < beta) score = -Negamax(worker, depth - 1, -beta, -alpha, ply + 1, opponent, true);
+        }
+        worker.path.pop_back();
+        worker.board.UnmakeMove(move.first.first, move.first.second, move.second.first, move.second.second, captured);
+        if (stop.load(memory_order_relaxed)) return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            best = EncodeMove(move);
+            if (ply == 0) worker.rootMove = best;
+        }
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) {
+            if (quiet) {
+                uint16_t code = EncodeMove(move);
+                if (worker.killers[ply][0] != code) {
+                    worker.killers[ply][1] = worker.killers[ply][0];
+                    worker.killers[ply][0] = code;
+                }
+                worker.historyTable[code & 0x7F][code >> 7] += depth * depth;
+            }
+            break;
+        }
+    }
+
+    BoundType bound = bestScore >= beta ? BOUND_LOWER : (bestScore > originalAlpha ? BOUND_EXACT : BOUND_UPPER);
+    table.Store(key, ply, best, bestScore, depth, bound);
+    return bestScore;
+}
+
+// 迭代加深，辅助线程从更深一层开始以错开搜索
+void AlphaBetaAI::IterativeDeepening(Worker& worker, int maxDepth) {
+    for (int depth = 1 + (worker.id % 2); depth <= maxDepth; ++depth) {
+        worker.rootMove = 0;
+        int score = Negamax(worker, depth, -AB_INFINITY, AB_INFINITY, 0, player, false);
+        if (stop.load()) break;
+        worker.bestMove = worker.rootMove;
+        worker.bestScore = score;
+        worker.completedDepth = depth;
+        if (worker.id == 0) searchDepth.store(depth);
+        if (abs(score) >= AB_MATE - AB_MAX_PLY) break;
+    }
+}
+
+// Lazy SMP：所有线程共享置换表独立搜索，主线程结束后停止其余线程
+void AlphaBetaAI::Search(const SearchLimits& limits) {
+    stop.store(false);
+    totalNodes.store(0);
+    searchDepth.store(0);
+    // 设置对局时钟时按时间管理的基础用时搜索
+    int timeMs = limits.clockMs > 0 ? TimeManager(limits.clockMs, limits.incrementMs).BaseMs() : limits.timeMs;
+    deadline = chrono::steady_clock::now() + chrono::milliseconds(timeMs);
+    int threadNum = max(1, limits.threadNum);
+    int maxDepth = min(max(1, limits.depth), AB_MAX_PLY - 1);
+
+    vector<Worker> workers(threadNum);
+    for (int i = 0; i < threadNum; ++i) {
+        Worker& worker = workers[i];
+        worker.id = i;
+        worker.board = board;
+        worker.path = gamePath;
+        memset(worker.killers, 0, sizeof(worker.killers));
+        memset(worker.historyTable, 0, sizeof(worker.historyTable));
+        worker.nodes = 0;
+        worker.rootMove = 0;
+        worker.bestMove = 0;
+        worker.bestScore = 0;
+        worker.completedDepth = 0;
+    }
+
+    vector<thread> threads;
+    for (int i = 1; i < threadNum; ++i) {
+        threads.push_back(thread(&AlphaBetaAI::IterativeDeepening, this, ref(workers[i]), maxDepth));
+    }
+    IterativeDeepening(workers[0], maxDepth);
+    stop.store(true);
+    for (auto& thread : threads) thread.join();
+
+    // 主线程未完成任何迭代时采用完成深度最大的辅助线程结果
+    Worker* result = &workers[0];
+    for (auto& worker : workers) {
+        if (worker.completedDepth > result->completedDepth) result = &worker;
+    }
+    uint64_t nodes = 0;
+    for (auto& worker : workers) nodes += worker.nodes;
+    totalNodes.store(nodes);
+    bestMove = result->bestMove;
+    bestScore = result->bestScore;
+    bestDepth = result->completedDepth;
+    if (bestMove == 0) {
+        auto moves = board.GenerateMoves(player);
+        if (!moves.empty()) bestMove = EncodeMove(moves[0]);
+    }
+}
+
+pair<pair<int, int>, pair<int, int>> AlphaBetaAI::GetBestMove() {
+    return DecodeMove(bestMove);
+}
+
+void AlphaBetaAI::Update(pair<pair<int, int>, pair<int, int>> move) {
+    bool irreversible = PositionHistory::IsIrreversible(board, move);
+    board.MakeMove(move.first.first, move.first.second, move.second.first, move.second.second);
+    player = (player == RED) ? BLACK : RED;
+    if (irreversible) gamePath.clear();
+    gamePath.push_back(board.GetHash(player));
+    bestMove = 0;
+}
+
+void AlphaBetaAI::Reset(const ChessBoard& board, Color player) {
+    this->board = board;
+    this->player = player;
+    gamePath.clear();
+    gamePath.push_back(board.GetHash(player));
+    table.Clear();
+    bestMove = 0;
+    bestScore = 0;
+    bestDepth = 0;
+}
+
+void AlphaBetaAI::Stop() {
+    stop.store(true);
+}
+
+SearchProgress AlphaBetaAI::GetProgress() const {
+    SearchProgress progress;
+    progress.nodes = totalNodes.load();
+    progress.depth = searchDepth.load();
+    return progress;
+}
+
+int AlphaBetaAI::GetScore() const {
+    return bestScore;
+}
+
+int AlphaBetaAI::GetDepth() const {
+    return bestDepth;
+}
+
+uint64_t AlphaBetaAI::GetNodes() const {
+    return totalNodes.load();
+}
\ No newline at end of file
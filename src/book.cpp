@@ -0,0 +1,204 @@
+#include "book.h"
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+OpeningBook::OpeningBook() {
+    data = nullptr;
+    size = 0;
+    entries = nullptr;
+    entryCount = 0;
+}
+
+OpeningBook::~OpeningBook() {
+    Close();
+}
+
+// 映射开局库文件
+bool OpeningBook::Open(const string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(BookFileHeader)) {
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    data = static_cast<const uint8_t*>(mapped);
+    size = st.st_size;
+
+    const BookFileHeader* header = reinterpret_cast<const BookFileHeader*>(data);
+    if (memcmp(header->magic, BOOK_FILE_MAGIC, 4) != 0 || header->version != BOOK_FILE_VERSION ||
+        sizeof(BookFileHeader) + (size_t)header->entryCount * sizeof(BookEntry) > size) {
+        Close();
+        return false;
+    }
+    entries = reinterpret_cast<const BookEntry*>(header + 1);
+    entryCount = header->entryCount;
+    return true;
+}
+
+void OpeningBook::Close() {
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+    data = nullptr;
+    size = 0;
+    entries = nullptr;
+    entryCount = 0;
+}
+
+bool OpeningBook::IsOpen() const {
+    return data != nullptr;
+}
+
+size_t OpeningBook::EntryCount() const {
+    return entryCount;
+}
+
+// 二分查找局面哈希，返回所有合法的库内走法
+vector<pair<pair<pair<int, int>, pair<int, int>>, int>> OpeningBook::GetMoves(const ChessBoard& board, Color player) const {
+    vector<pair<pair<pair<int, int>, pair<int, int>>, int>> moves;
+    if (!entries) return moves;
+    uint64_t key = board.GetHash(player);
+    const BookEntry* first = lower_bound(entries, entries + entryCount, key, [](const BookEntry& entry, uint64_t key) {
+        return entry.key < key;
+    });
+    for (const BookEntry* entry = first; entry != entries + entryCount && entry->key == key; ++entry) {
+        // 损坏或格式不符的库中走法可能不在棋盘内
+        if (!IsValidMoveCode(entry->move)) continue;
+        auto move = DecodeMove(entry->move);
+        const ChessPiece* piece = board.GetPiece(move.first.first, move.first.second);
+        // 防止哈希冲突导致的非法走法
+        if (piece->color != player || !board.IsValidMove(move.first.first, move.first.second, move.second.first, move.second.second)) continue;
+        moves.push_back({move, entry->weight});
+    }
+    return moves;
+}
+
+// 按权重随机选择走法
+bool OpeningBook::Probe(const ChessBoard& board, Color player, pair<pair<int, int>, pair<int, int>>& move) const {
+    auto moves = GetMoves(board, player);
+    int total = 0;
+    for (const auto& item : moves) total += item.second;
+    if (total <= 0) return false;
+    int pick = rand() % total;
+    for (const auto& item : moves) {
+        pick -= item.second;
+        if (pick < 0) {
+            move = item.first;
+            return true;
+        }
+    }
+    return false;
+}
+
+OpeningBookBuilder::OpeningBookBuilder(int maxPly) {
+    this->maxPly = maxPly;
+}
+
+void OpeningBookBuilder::AddMove(const ChessBoard& board, Color player, const pair<pair<int, int>, pair<int, int>>& move, int weight) {
+    if (weight <= 0) return;
+    BookEntry entry;
+    entry.key = board.GetHash(player);
+    entry.move = EncodeMove(move);
+    entry.weight = min(weight, (int)UINT16_MAX);
+    entries.push_back(entry);
+}
+
+// 添加对局
+void OpeningBookBuilder::AddGame(const vector<pair<pair<int, int>, pair<int, int>>>& moves, GameResult result) {
+    ChessBoard board;
+    Color player = RED;
+    for (int ply = 0; ply < maxPly && ply < (int)moves.size(); ++ply) {
+        const auto& move = moves[ply];
+        int weight = 1;
+        if (result == RED_WIN) weight = player == RED ? 2 : 0;
+        else if (result == BLACK_WIN) weight = player == BLACK ? 2 : 0;
+        AddMove(board, player, move, weight);
+        if (!board.MovePiece(move.first.first, move.first.second, move.second.first, move.second.second)) break;
+        player = (player == RED) ? BLACK : RED;
+    }
+}
+
+void OpeningBookBuilder::AddRecordFile(const GameRecordFile& file) {
+    vector<pair<pair<int, int>, pair<int, int>>> moves;
+    GameResult result;
+    for (size_t i = 0; i < file.RecordCount(); ++i) {
+        if (file.GetType(i) == RECORD_GAME && file.ReadGame(i, moves, result)) {
+            AddGame(moves, result);
+        }
+    }
+}
+
+// 自我对弈
+void OpeningBookBuilder::SelfPlay(int games, int iterations, int threadNum, unsigned seed) {
+    for (int game = 0; game < games; ++game) {
+        ChessBoard board;
+        Color player = RED;
+        MCTSAI ai(board, player);
+        if (seed) ai.SetSeed(seed + game);
+        for (int ply = 0; ply < maxPly; ++ply) {
+            ai.ParallelRun(iterations, threadNum);
+            int total = 0;
+            for (auto child : ai.root->children) total += child->VisitCount();
+            if (total <= 0) break;
+
+            // 访问占比不低于 5% 的走法计入开局库，权重为千分比
+            for (auto child : ai.root->children) {
+                if (child->VisitCount() * 20 >= total) {
+                    AddMove(board, player, child->GetLastMove(), child->VisitCount() * 1000 / total);
+                }
+            }
+
+            // 按访问次数随机选择实际走法，增加开局多样性
+            int pick = rand() % total;
+            pair<pair<int, int>, pair<int, int>> move = ai.GetBestMove();
+            for (auto child : ai.root->children) {
+                pick -= child->VisitCount();
+                if (pick < 0) {
+                    move = child->GetLastMove();
+                    break;
+                }
+            }
+            ai.Update(move);
+            board.MovePiece(move.first.first, move.first.second, move.second.first, move.second.second);
+            player = (player == RED) ? BLACK : RED;
+            if (ChessBoard::IsGameOver(board, player) != NOT_OVER) break;
+        }
+    }
+}
+
+// 合并并写入开局库
+bool OpeningBookBuilder::Write(const string& path, int minWeight) {
+    sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) {
+        return a.key != b.key ? a.key < b.key : a.move < b.move;
+    });
+    vector<BookEntry> merged;
+    for (size_t i = 0; i < entries.size();) {
+        BookEntry entry = entries[i];
+        int weight = 0;
+        for (; i < entries.size() && entries[i].key == entry.key && entries[i].move == entry.move; ++i) {
+            weight += entries[i].weight;
+        }
+        if (weight < minWeight) continue;
+        entry.weight = min(weight, (int)UINT16_MAX);
+        merged.push_back(entry);
+    }
+
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.is_open()) return false;
+    BookFileHeader header;
+    memcpy(header.magic, BOOK_FILE_MAGIC, 4);
+    header.version = BOOK_FILE_VERSION;
+    header.reserved = 0;
+    header.entryCount = merged.size();
+    header.reserved2 = 0;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(merged.data()), merged.size() * sizeof(BookEntry));
+    return out.good();
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "evaluator.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <immintrin.h>
+
+void Evaluator::Evaluate(EvalRequest& request) {
+    EvalRequest* requests[1] = {&request};
+    EvaluateBatch(requests, 1);
+}
+
+BatchedEvaluator::BatchedEvaluator(Evaluator* inner, int batchSize, int timeoutUs) {
+    this->inner = inner;
+    this->batchSize = max(1, batchSize);
+    this->timeoutUs = timeoutUs;
+    batchCount = 0;
+    requestCount = 0;
+}
+
+BatchedEvaluator::~BatchedEvaluator() {
+    delete inner;
+}
+
+void BatchedEvaluator::EvaluateBatch(EvalRequest* const* requests, int count) {
+    inner->EvaluateBatch(requests, count);
+}
+
+// 取出当前所有待处理请求并在锁外执行
+void BatchedEvaluator::RunBatch(unique_lock<mutex>& lock) {
+    vector<EvalRequest*> batch;
+    batch.swap(pending);
+    batchCount++;
+    requestCount += batch.size();
+    lock.unlock();
+    inner->EvaluateBatch(batch.data(), batch.size());
+    lock.lock();
+    for (auto request : batch) request->done = true;
+    cv.notify_all();
+}
+
+void BatchedEvaluator::Evaluate(EvalRequest& request) {
+    unique_lock<mutex> lock(mtx);
+    request.done = false;
+    pending.push_back(&request);
+    if ((int)pending.size() >= batchSize) {
+        RunBatch(lock);
+        return;
+    }
+    auto deadline = chrono::steady_clock::now() + chrono::microseconds(timeoutUs);
+    while (!request.done) {
+        if (cv.wait_until(lock, deadline) == cv_status::timeout && !request.done) {
+            // 超时仍未凑满一批，由本线程执行已有请求
+            if (!pending.empty()) RunBatch(lock);
+            else cv.wait(lock, [&request] { return request.done; });
+        }
+    }
+}
+
+uint64_t BatchedEvaluator::GetBatchCount() const {
+    return batchCount;
+}
+
+uint64_t BatchedEvaluator::GetRequestCount() const {
+    return requestCount;
+}
+
+// 标量实现，与 AVX2 实现一样按输入顺序以融合乘加累计，同一样本的结果与其在批次中的位置和指令集无关
+static void DenseForwardScalar(const float* in, int batch, int inputs, const float* weights, const float* bias, int outputs, float* out) {
+    for (int b = 0; b < batch; ++b) {
+        float* row = out + (size_t)b * outputs;
+        for (int o = 0; o < outputs; ++o) row[o] = bias[o];
+        for (int i = 0; i < inputs; ++i) {
+            float x = in[(size_t)b * inputs + i];
+            if (x == 0.0f) continue;
+            const float* w = weights + (size_t)i * outputs;
+            for (int o = 0; o < outputs; ++o) row[o] = fmaf(x, w[o], row[o]);
+        }
+    }
+}
+
+// AVX2 实现：每次处理 4 个样本共享同一行权重，输出按 8 路向量计算
+// 不足 4 个的剩余样本逐个用相同的向量融合乘加计算，保证各样本结果与所在位置无关
+__attribute__((target("avx2,fma")))
+static void DenseForwardAvx2(const float* in, int batch, int inputs, const float* weights, const float* bias, int outputs, float* out) {
+    int vecOutputs = outputs & ~7;
+    int b = 0;
+    for (; b + 4 <= batch; b += 4) {
+        for (int o = 0; o < vecOutputs; o += 8) {
+            __m256 acc0 = _mm256_loadu_ps(bias + o);
+            __m256 acc1 = acc0, acc2 = acc0, acc3 = acc0;
+            for (int i = 0; i < inputs; ++i) {
+                __m256 w = _mm256_loadu_ps(weights + (size_t)i * outputs + o);
+                acc0 = _mm256_fmadd_ps(_mm256_set1_ps(in[(size_t)(b + 0) * inputs + i]), w, acc0);
+                acc1 = _mm256_fmadd_ps(_mm256_set1_ps(in[(size_t)(b + 1) * inputs + i]), w, acc1);
+                acc2 = _mm256_fmadd_ps(_mm256_set1_ps(in[(size_t)(b + 2) * inputs + i]), w, acc2);
+                acc3 = _mm256_fmadd_ps(_mm256_set1_ps(in[(size_t)(b + 3) * inputs + i]), w, acc3);
+            }
+            _mm256_storeu_ps(out + (size_t)(b + 0) * outputs + o, acc0);
+            _mm256_storeu_ps(out + (size_t)(b + 1) * outputs + o, acc1);
+            _mm256_storeu_ps(out + (size_t)(b + 2) * outputs + o, acc2);
+            _mm256_storeu_ps(out + (size_t)(b + 3) * outputs + o, acc3);
+        }
+        for (int k = 0; k < 4; ++k) {
+            for (int o = vecOutputs; o < outputs; ++o) {
+                float sum = bias[o];
+                for (int i = 0; i < inputs; ++i) sum = fmaf(in[(size_t)(b + k) * inputs + i], weights[(size_t)i * outputs + o], sum);
+                out[(size_t)(b + k) * outputs + o] = sum;
+            }
+        }
+    }
+    for (; b < batch; ++b) {
+        for (int o = 0; o < vecOutputs; o += 8) {
+            __m256 acc = _mm256_loadu_ps(bias + o);
+            for (int i = 0; i < inputs; ++i) {
+                acc = _mm256_fmadd_ps(_mm256_set1_ps(in[(size_t)b * inputs + i]), _mm256_loadu_ps(weights + (size_t)i * outputs + o), acc);
+            }
+            _mm256_storeu_ps(out + (size_t)b * outputs + o, acc);
+        }
+        for (int o = vecOutputs; o < outputs; ++o) {
+            float sum = bias[o];
+            for (int i = 0; i < inputs; ++i) sum = fmaf(in[(size_t)b * inputs + i], weights[(size_t)i * outputs + o], sum);
+            out[(size_t)b * outputs + o] = sum;
+        }
+    }
+}
+
+void DenseForward(const float* in, int batch, int inputs, const float* weights, const float* bias, int outputs, float* out) {
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (hasAvx2) DenseForwardAvx2(in, batch, inputs, weights, bias, outputs, out);
+    else DenseForwardScalar(in, batch, inputs, weights, bias, outputs, out);
+}
+
+PolicyValueNet::PolicyValueNet(int hidden1, int hidden2) {
+    this->hidden1 = hidden1;
+    this->hidden2 = hidden2;
+    Initialize();
+}
+
+// Xavier 均匀分布初始化
+void PolicyValueNet::Initialize(uint32_t seed) {
+    mt19937 rng(seed);
+    auto fill = [&rng](vector<float>& weights, size_t size, int fanIn, int fanOut) {
+        uniform_real_distribution<float> dist(-sqrt(6.0f / (fanIn + fanOut)), sqrt(6.0f / (fanIn + fanOut)));
+        weights.resize(size);
+        for (auto& w : weights) w = dist(rng);
+    };
+    // 输入稀疏，约 32 个特征同时激活
+    fill(inputWeights, (size_t)NETWORK_INPUTS * hidden1, 32, hidden1);
+    inputBias.assign(hidden1, 0.0f);
+    fill(hiddenWeights, (size_t)hidden1 * hidden2, hidden1, hidden2);
+    hiddenBias.assign(hidden2, 0.0f);
+    fill(policyWeights, (size_t)hidden2 * NETWORK_POLICY, hidden2, NETWORK_POLICY);
+    policyBias.assign(NETWORK_POLICY, 0.0f);
+    fill(valueWeights, hidden2, hidden2, 1);
+    valueBias = 0.0f;
+}
+
+bool PolicyValueNet::Load(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) return false;
+    char magic[4];
+    int32_t dims[2];
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(dims), sizeof(dims));
+    if (!in.good() || memcmp(magic, NETWORK_FILE_MAGIC, 4) != 0 || dims[0] <= 0 || dims[1] <= 0) return false;
+    hidden1 = dims[0];
+    hidden2 = dims[1];
+    inputWeights.resize((size_t)NETWORK_INPUTS * hidden1);
+    inputBias.resize(hidden1);
+    hiddenWeights.resize((size_t)hidden1 * hidden2);
+    hiddenBias.resize(hidden2);
+    policyWeights.resize((size_t)hidden2 * NETWORK_POLICY);
+    policyBias.resize(NETWORK_POLICY);
+    valueWeights.resize(hidden2);
+    for (vector<float>* weights : {&inputWeights, &inputBias, &hiddenWeights, &hiddenBias, &policyWeights, &policyBias, &valueWeights}) {
+        in.read(reinterpret_cast<char*>(weights->data()), weights->size() * sizeof(float));
+    }
+    in.read(reinterpret_cast<char*>(&valueBias), sizeof(valueBias));
+    if (!in.good()) {
+        Initialize();
+        return false;
+    }
+    return true;
+}
+
+bool PolicyValueNet::Save(const string& path) const {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.is_open()) return false;
+    int32_t dims[2] = {hidden1, hidden2};
+    out.write(NETWORK_FILE_MAGIC, 4);
+    out.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+    for (const vector<float>* weights : {&inputWeights, &inputBias, &hiddenWeights, &hiddenBias, &policyWeights, &policyBias, &valueWeights}) {
+        out.write(reinterpret_cast<const char*>(weights->data()), weights->size() * sizeof(float));
+    }
+    out.write(reinterpret_cast<const char*>(&valueBias), sizeof(valueBias));
+    return out.good();
+}
+
+int PolicyValueNet::PerspectiveSquare(int row, int col, Color player) {
+    if (player == BLACK) row = BOARD_HEIGHT - 1 - row;
+    return row * BOARD_WIDTH + col;
+}
+
+// 批量前向计算
+void PolicyValueNet::EvaluateBatch(EvalRequest* const* requests, int count) {
+    if (count <= 0) return;
+    vector<float> layer1((size_t)count * hidden1);
+    vector<float> layer2((size_t)count * hidden2);
+    vector<float> policy((size_t)count * NETWORK_POLICY);
+
+    // 第一层：输入为 0/1 稀疏特征，直接累加激活特征对应的权重行
+    for (int b = 0; b < count; ++b) {
+        const EvalRequest* request = requests[b];
+        float* acc = layer1.data() + (size_t)b * hidden1;
+        memcpy(acc, inputBias.data(), hidden1 * sizeof(float));
+        for (int row = 0; row < BOARD_HEIGHT; ++row) {
+            for (int col = 0; col < BOARD_WIDTH; ++col) {
+                const ChessPiece* piece = request->board->GetPiece(row, col);
+                if (piece->type == EMPTY) continue;
+                int plane = (piece->color == request->player ? 0 : 7) + piece->type - 1;
+                const float* w = inputWeights.data() + ((size_t)plane * BOARD_HEIGHT * BOARD_WIDTH + PerspectiveSquare(row, col, request->player)) * hidden1;
+                for (int h = 0; h < hidden1; ++h) acc[h] += w[h];
+            }
+        }
+        for (int h = 0; h < hidden1; ++h) acc[h] = max(acc[h], 0.0f);
+    }
+
+    // 第二层与策略头使用批量矩阵乘
+    DenseForward(layer1.data(), count, hidden1, hiddenWeights.data(), hiddenBias.data(), hidden2, layer2.data());
+    for (auto& x : layer2) x = max(x, 0.0f);
+    DenseForward(layer2.data(), count, hidden2, policyWeights.data(), policyBias.data(), NETWORK_POLICY, policy.data());
+
+    for (int b = 0; b < count; ++b) {
+        EvalRequest* request = requests[b];
+        const float* h = layer2.data() + (size_t)b * hidden2;
+        float value = valueBias;
+        for (int k = 0; k < hidden2; ++k) value += h[k] * valueWeights[k];
+        request->value = tanh(value);
+
+        // 走法得分 = 起点得分 + 终点得分，对合法走法做 softmax
+        const float* logits = policy.data() + (size_t)b * NETWORK_POLICY;
+        const auto& moves = *request->moves;
+        request->priors.resize(moves.size());
+        float maxLogit = -1e30f;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            int from = PerspectiveSquare(moves[i].first.first, moves[i].first.second, request->player);
+            int to = PerspectiveSquare(moves[i].second.first, moves[i].second.second, request->player);
+            request->priors[i] = logits[from] + logits[BOARD_HEIGHT * BOARD_WIDTH + to];
+            maxLogit = max(maxLogit, request->priors[i]);
+        }
+        float sum = 0.0f;
+        for (auto& p : request->priors) {
+            p = exp(p - maxLogit);
+            sum += p;
+        }
+        for (auto& p : request->priors) p /= sum;
+    }
+}
\ No newline at end of file
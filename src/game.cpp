@@ -1,68 +1,308 @@
 #include "game.h"
 
+static const int EVENT_TICK_MS = 10; // 搜索期间事件循环的唤醒间隔（毫秒）
+
+string FormatMove(const pair<pair<int, int>, pair<int, int>>& move) {
+    string text = "a0-a0";
+    text[0] = 'a' + move.first.second;
+    text[1] = '0' + move.first.first;
+    text[3] = 'a' + move.second.second;
+    text[4] = '0' + move.second.first;
+    return text;
+}
+
+void GameEventQueue::Post(const GameEvent& event) {
+    {
+        lock_guard<mutex> lock(mtx);
+        events.push_back(event);
+    }
+    cv.notify_one();
+}
+
+bool GameEventQueue::Wait(GameEvent& event, int timeoutMs) {
+    unique_lock<mutex> lock(mtx);
+    auto ready = [this]() { return !events.empty(); };
+    if (timeoutMs < 0) cv.wait(lock, ready);
+    else if (!cv.wait_for(lock, chrono::milliseconds(timeoutMs), ready)) return false;
+    event = events.front();
+    events.pop_front();
+    return true;
+}
+
 ChessGame::~ChessGame(){
+    CancelSearch();
+    delete this->engine;
     delete this->board;
 }
 
-ChessGame::ChessGame(ChessBoard *board, MCTSAI& ai){
+ChessGame::ChessGame(ChessBoard *board, const GameConfig& config){
     this->currentPlayer = RED;
-    this->ai = ai;
-    this->aiColor = ai.root->currentPlayer;
+    this->config = config;
+    this->aiColor = config.aiColor;
+    this->engine = CreateEngine(config, *board, currentPlayer);
     this->board = board;
+    this->recorder = nullptr;
+    this->book = nullptr;
+    this->history.Reset(*board, currentPlayer);
+    this->events = make_shared<GameEventQueue>();
+    this->inputStarted = false;
+    this->searchFinished.store(true);
+    this->searching = false;
+    this->stopRequested = false;
+    this->searchId = 0;
+    this->clockMs = config.clockMs;
+}
+
+SearchEngine* ChessGame::CreateEngine(const GameConfig& config, const ChessBoard& board, Color player) {
+    switch (config.engine) {
+        case ENGINE_ALPHABETA:
+            return new AlphaBetaAI(board, player, config.hashSizeMB);
+        case ENGINE_MCTS:
+        default:
+            return new MCTSAI(board, player);
+    }
+}
+
+void ChessGame::SetOpeningBook(const OpeningBook* book) {
+    this->book = book;
+}
+
+void ChessGame::SetRecorder(GameRecordWriter* recorder) {
+    this->recorder = recorder;
 }
 
 void ChessGame::Start() {
-    time_t startTime, endTime;
+    StartInput();
+    bool prompt = true; // 进入新的回合，需要输出局面
+    auto lastProgress = chrono::steady_clock::now();
     while (true) {
-        board->Print(true);
-        cout << (currentPlayer == RED ? "红方" : "黑方") << "的回合" << endl;
-        if (currentPlayer == aiColor)
-        {
-            srand(time(nullptr));
-
-            time(&startTime);
-            // ai.Run(2000); // 运行 1000 次模拟
-            ai.ParallelRun(4000, 10);
-            time(&endTime);
+        if (prompt) {
+            prompt = false;
+            board->Print(true);
+            cout << (currentPlayer == RED ? "红方" : "黑方") << "的回合" << endl;
+            if (currentPlayer == aiColor) {
+                pair<pair<int, int>, pair<int, int>> bestMove;
+                if (book && book->Probe(*board, currentPlayer, bestMove)) {
+                    // 开局库命中，直接走子
+                    cout << "开局库走法" << endl;
+                    cout << "最佳移动: (" << bestMove.first.first << ", " << bestMove.first.second << ") -> ("
+                        << bestMove.second.first << ", " << bestMove.second.second << ")" << endl;
+                    GameResult result;
+                    if (!PlayEngineMove(bestMove, result)) return;
+                    if (result != NOT_OVER) {
+                        Finish(result);
+                        return;
+                    }
+                    prompt = true;
+                    continue;
+                }
+                StartSearch();
+                lastProgress = searchStart;
+            }
+            else {
+                cout << "输入移动（例如 a0 a1）：" << flush;
+            }
+        }
 
-            cout << "AI 运行时间：" << difftime(endTime, startTime) << "秒" << endl;
+        GameEvent event;
+        if (!events->Wait(event, searching ? EVENT_TICK_MS : -1)) {
+            // 搜索期间定时唤醒：重复停止请求并输出进度
+            if (stopRequested) engine->Stop();
+            auto now = chrono::steady_clock::now();
+            if (config.progressMs > 0 && now - lastProgress >= chrono::milliseconds(config.progressMs)) {
+                lastProgress = now;
+                SearchProgress progress = engine->GetProgress();
+                cout << "搜索中：" << chrono::duration<double>(now - searchStart).count() << "秒，节点 " << progress.nodes;
+                if (progress.depth > 0) cout << "，深度 " << progress.depth;
+                MCTSAI* mcts = dynamic_cast<MCTSAI*>(engine);
+                SearchSnapshot snapshot;
+                if (mcts) snapshot = mcts->GetSnapshot();
+                if (!snapshot.pv.empty()) {
+                    cout << "，最佳 " << FormatMove(snapshot.bestMove) << "（" << (int)(snapshot.share * 100) << "%，价值 " << snapshot.value << "），主要变例";
+                    for (const auto& move : snapshot.pv) cout << " " << FormatMove(move);
+                }
+                cout << endl;
+            }
+            continue;
+        }
 
-            auto bestMove = ai.GetBestMove();
+        if (event.type == EVENT_SEARCH_DONE) {
+            // 已取消搜索的结束事件直接丢弃
+            if (!searching || event.search != searchId) continue;
+            searchTask.join();
+            searching = false;
+            auto elapsed = chrono::steady_clock::now() - searchStart;
+            cout << "AI 运行时间：" << chrono::duration<double>(elapsed).count() << "秒" << endl;
+            if (config.clockMs > 0) {
+                clockMs -= (int)chrono::duration_cast<chrono::milliseconds>(elapsed).count();
+                if (clockMs <= 0) {
+                    cout << "AI 超时" << endl;
+                    Finish(aiColor == RED ? BLACK_WIN : RED_WIN);
+                    return;
+                }
+                clockMs += config.incrementMs;
+                cout << "AI 剩余时间：" << clockMs / 1000.0 << "秒" << endl;
+            }
+            pair<pair<int, int>, pair<int, int>> bestMove = engine->GetBestMove();
+            // 保存本步搜索树，下次对局可通过 --tree 热启动
+            MCTSAI* mcts = dynamic_cast<MCTSAI*>(engine);
+            if (recorder && mcts) recorder->WriteTree(mcts->root);
             cout << "最佳移动: (" << bestMove.first.first << ", " << bestMove.first.second << ") -> ("
                 << bestMove.second.first << ", " << bestMove.second.second << ")" << endl;
-            // ai.AutoUpdate();
-            ai.Update(bestMove);
-            currentPlayer = (currentPlayer == RED) ? BLACK : RED;
-            board->MovePiece(bestMove.first.first, bestMove.first.second, bestMove.second.first, bestMove.second.second);
-            // ai.root->Print();
-        }
-        else{
-            string input;
-            cout << "输入移动（例如 a0 a1）：";
-            getline(cin, input);
-
-            auto positions = ParseInput(input);
-            if (positions.size() != 2) {
-                cout << "无效输入！" << endl;
-                continue;
+            GameResult result;
+            if (!PlayEngineMove(bestMove, result)) return;
+            if (result != NOT_OVER) {
+                Finish(result);
+                return;
             }
+            prompt = true;
+            continue;
+        }
+
+        if (event.type == EVENT_INPUT_CLOSED) {
+            // 输入结束时放弃对局
+            CancelSearch();
+            return;
+        }
 
-            if (board->MovePiece(positions[0].first, positions[0].second, positions[1].first, positions[1].second)) {
-                currentPlayer = (currentPlayer == RED) ? BLACK : RED;
-                pair<pair<int, int>, pair<int, int>> move = {positions[0], positions[1]};
-                ai.Update(move);
-            } else {
-                cout << "非法移动！" << endl;
-                continue;
+        string input = event.text;
+        input.erase(0, input.find_first_not_of(" \t\r"));
+        input.erase(input.find_last_not_of(" \t\r") + 1);
+        if (input == "quit") {
+            CancelSearch();
+            return;
+        }
+        if (input == "resign") {
+            CancelSearch();
+            Finish(aiColor == RED ? RED_WIN : BLACK_WIN);
+            return;
+        }
+        if (input == "new") {
+            CancelSearch();
+            NewGame();
+            prompt = true;
+            continue;
+        }
+        if (input == "stop") {
+            // 搜索结束后使用当前结果走子
+            if (searching) {
+                stopRequested = true;
+                engine->Stop();
+            }
+            else {
+                cout << "当前没有进行中的搜索" << endl;
             }
+            continue;
+        }
+        if (searching) {
+            cout << "AI 思考中，可输入 stop、resign、new 或 quit" << endl;
+            continue;
+        }
+
+        auto positions = ParseInput(input);
+        if (positions.size() != 2) {
+            cout << "无效输入！" << endl;
+            prompt = true;
+            continue;
         }
-        if (ai.root->IsGameOver(*board, currentPlayer) != NOT_OVER)
-        {
-            break;
+        GameResult result;
+        if (!PlayMove({positions[0], positions[1]}, result)) {
+            cout << "非法移动！" << endl;
+            prompt = true;
+            continue;
         }
-        
-        
+        if (result != NOT_OVER) {
+            Finish(result);
+            return;
+        }
+        prompt = true;
+    }
+}
+
+// 阻塞在 getline 上的线程无法中断，因此分离运行，由队列的共享所有权保证安全
+void ChessGame::StartInput() {
+    if (inputStarted) return;
+    inputStarted = true;
+    shared_ptr<GameEventQueue> queue = events;
+    thread([queue]() {
+        string line;
+        while (getline(cin, line)) queue->Post({EVENT_INPUT, line, 0});
+        queue->Post({EVENT_INPUT_CLOSED, "", 0});
+    }).detach();
+}
+
+void ChessGame::StartSearch() {
+    // 固定种子时按步数区分，使同一对局可以复现
+    srand(config.seed ? config.seed + (unsigned)moveHistory.size() : time(nullptr));
+    searching = true;
+    stopRequested = false;
+    searchFinished.store(false);
+    searchStart = chrono::steady_clock::now();
+    int id = ++searchId;
+    SearchLimits limits = config.limits;
+    if (config.seed) limits.seed = config.seed + (unsigned)moveHistory.size();
+    if (config.clockMs > 0) {
+        limits.clockMs = clockMs;
+        limits.incrementMs = config.incrementMs;
     }
+    searchTask = thread([this, id, limits]() {
+        engine->Search(limits);
+        searchFinished.store(true);
+        events->Post({EVENT_SEARCH_DONE, "", id});
+    });
+}
+
+// 引擎在搜索开始时清除停止请求，因此重复请求直到任务结束
+void ChessGame::CancelSearch() {
+    if (!searching) return;
+    while (!searchFinished.load()) {
+        engine->Stop();
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    searchTask.join();
+    searching = false;
+}
+
+bool ChessGame::PlayMove(pair<pair<int, int>, pair<int, int>> move, GameResult& result) {
+    ChessBoard before = *board;
+    if (!board->MovePiece(move.first.first, move.first.second, move.second.first, move.second.second)) return false;
+    currentPlayer = (currentPlayer == RED) ? BLACK : RED;
+    history.Push(before, *board, currentPlayer, move);
+    engine->Update(move);
+    moveHistory.push_back(move);
+    result = ChessBoard::IsGameOver(*board, currentPlayer);
+    // 同一局面第三次出现时按重复规则裁决
+    if (result == NOT_OVER) result = history.CheckRepetition(*board, 2);
+    return true;
+}
+
+bool ChessGame::PlayEngineMove(pair<pair<int, int>, pair<int, int>> move, GameResult& result) {
+    if (PlayMove(move, result)) return true;
+    cout << "AI 走法非法：" << FormatMove(move) << endl;
+    auto legal = board->GenerateMoves(currentPlayer);
+    if (legal.empty()) {
+        cout << "没有可走的合法走法，对局中止" << endl;
+        return false;
+    }
+    // 引擎与对局局面不一致，按当前局面重建搜索树后改走第一个合法走法
+    engine->Reset(*board, currentPlayer);
+    cout << "改走：" << FormatMove(legal[0]) << endl;
+    return PlayMove(legal[0], result);
+}
+
+void ChessGame::NewGame() {
+    board->InitializeBoard();
+    currentPlayer = RED;
+    moveHistory.clear();
+    clockMs = config.clockMs;
+    history.Reset(*board, currentPlayer);
+    engine->Reset(*board, currentPlayer);
+}
+
+void ChessGame::Finish(GameResult result) {
+    if (recorder) recorder->WriteGame(moveHistory, result);
+    board->Print(true);
+    cout << (result == RED_WIN ? "红方胜" : (result == BLACK_WIN ? "黑方胜" : "和棋")) << endl;
 }
 
 vector<pair<int, int>> ChessGame::ParseInput(const string& input) {
@@ -0,0 +1,112 @@
+#include "history.h"
+
+PositionHistory::PositionHistory() {}
+
+void PositionHistory::Clear() {
+    entries.clear();
+}
+
+size_t PositionHistory::Size() const {
+    return entries.size();
+}
+
+void PositionHistory::Reset(const ChessBoard& board, Color currentPlayer) {
+    entries.clear();
+    entries.push_back({board.GetHash(currentPlayer), {{0, 0}, {0, 0}}});
+}
+
+void PositionHistory::Push(const ChessBoard& before, const ChessBoard& after, Color currentPlayer,
+                           const pair<pair<int, int>, pair<int, int>>& move) {
+    Push(after.GetHash(currentPlayer), move, IsIrreversible(before, move));
+}
+
+void PositionHistory::Push(uint64_t hash, const pair<pair<int, int>, pair<int, int>>& move, bool irreversible) {
+    if (irreversible) entries.clear();
+    entries.push_back({hash, move});
+}
+
+// 吃子或兵卒前进
+bool PositionHistory::IsIrreversible(const ChessBoard& before, const pair<pair<int, int>, pair<int, int>>& move) {
+    if (before.GetPiece(move.second.first, move.second.second)->type != EMPTY) return true;
+    return before.GetPiece(move.first.first, move.first.second)->type == PAWN && move.first.first != move.second.first;
+}
+
+// 判断捉子
+bool PositionHistory::IsChase(const ChessBoard& before, const ChessBoard& after,
+                              const pair<pair<int, int>, pair<int, int>>& move) {
+    const ChessPiece* piece = after.GetPiece(move.second.first, move.second.second);
+    if (piece->type == KING || piece->type == PAWN) return false; // 将帅与兵卒可以长捉
+    Color opponent = (piece->color == RED) ? BLACK : RED;
+
+    for (int row = 0; row < BOARD_HEIGHT; ++row) {
+        for (int col = 0; col < BOARD_WIDTH; ++col) {
+            const ChessPiece* target = after.GetPiece(row, col);
+            if (target->color != opponent || target->type == KING) continue;
+            // 未过河的兵卒不算被捉
+            if (target->type == PAWN && (opponent == RED ? row <= 4 : row >= 5)) continue;
+            if (!after.IsValidMove(move.second.first, move.second.second, row, col)) continue;
+            if (before.IsValidMove(move.first.first, move.first.second, row, col)) continue;
+
+            if (target->type == ROOK && (piece->type == HORSE || piece->type == CANNON)) return true;
+
+            // 吃掉目标后对方能否反吃，不能则为无根子
+            ChessBoard captured = after;
+            captured.SetPiece(row, col, piece->type, piece->color);
+            captured.SetPiece(move.second.first, move.second.second, EMPTY, NONE);
+            bool protectedPiece = false;
+            for (int r = 0; r < BOARD_HEIGHT && !protectedPiece; ++r) {
+                for (int c = 0; c < BOARD_WIDTH && !protectedPiece; ++c) {
+                    if (captured.GetPiece(r, c)->color == opponent && captured.IsValidMove(r, c, row, col)) {
+                        protectedPiece = true;
+                    }
+                }
+            }
+            if (!protectedPiece) return true;
+        }
+    }
+    return false;
+}
+
+// 判断重复局面
+GameResult PositionHistory::CheckRepetition(const ChessBoard& board, int repeats) const {
+    int n = entries.size();
+    if (n < 5) return NOT_OVER;
+    uint64_t last = entries[n - 1].hash;
+    int count = 0, start = -1;
+    for (int k = n - 3; k >= 0; k -= 2) {
+        if (entries[k].hash != last) continue;
+        if (start < 0) start = k;
+        if (++count >= repeats) break;
+    }
+    if (count < repeats) return NOT_OVER;
+
+    // 循环中没有吃子，直接把棋子挪回原位即可还原之前的局面
+    bool allCheck[3] = {false, true, true};
+    bool allChase[3] = {false, true, true};
+    bool moved[3] = {false, false, false};
+    ChessBoard after = board;
+    for (int k = n - 1; k > start; --k) {
+        const auto& move = entries[k].move;
+        ChessBoard before = after;
+        const ChessPiece* piece = after.GetPiece(move.second.first, move.second.second);
+        Color mover = piece->color;
+        before.SetPiece(move.first.first, move.first.second, piece->type, piece->color);
+        before.SetPiece(move.second.first, move.second.second, EMPTY, NONE);
+
+        bool check = after.IsInCheck((mover == RED) ? BLACK : RED);
+        moved[mover] = true;
+        if (!check) allCheck[mover] = false;
+        if (!check && !IsChase(before, after, move)) allChase[mover] = false;
+        after = before;
+    }
+    for (int color = RED; color <= BLACK; ++color) {
+        if (!moved[color]) allCheck[color] = allChase[color] = false;
+        // 将捉交替按长捉处理，纯长将单独判定
+        if (allCheck[color]) allChase[color] = false;
+    }
+
+    if (allCheck[RED] != allCheck[BLACK]) return allCheck[RED] ? BLACK_WIN : RED_WIN;
+    if (allCheck[RED]) return DRAW;
+    if (allChase[RED] != allChase[BLACK]) return allChase[RED] ? BLACK_WIN : RED_WIN;
+    return DRAW;
+}
\ No newline at end of file
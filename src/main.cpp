@@ -1,15 +1,432 @@
 #include <ctime>
 #include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <sstream>
 #include "piece.h"
 #include "mcts.h"
 #include "game.h"
+#include "record.h"
+#include "book.h"
+#include "tablebase.h"
+#include "evaluator.h"
+#include "nnue.h"
+#include "movegen.h"
+#include "server.h"
 
+// 固定种子的随机对局，供性能测试使用
+static vector<vector<pair<pair<int, int>, pair<int, int>>>> RandomGames(int games, size_t& total) {
+    srand(1);
+    vector<vector<pair<pair<int, int>, pair<int, int>>>> records;
+    total = 0;
+    for (int g = 0; g < games; ++g) {
+        ChessBoard board;
+        board.InitializeBoard();
+        Color player = RED;
+        vector<pair<pair<int, int>, pair<int, int>>> moves;
+        while (moves.size() < 200 && ChessBoard::IsGameOver(board, player) == NOT_OVER) {
+            auto legal = board.GenerateMoves(player);
+            if (legal.empty()) break;
+            auto move = legal[rand() % legal.size()];
+            board.MakeMove(move.first.first, move.first.second, move.second.first, move.second.second);
+            moves.push_back(move);
+            player = (player == RED) ? BLACK : RED;
+        }
+        total += moves.size();
+        records.push_back(moves);
+    }
+    return records;
+}
 
-int main() {
-    ChessBoard board = ChessBoard();
-    MCTSAI ai = MCTSAI(board, RED);
-    ChessGame game = ChessGame(&board, ai);
+// 比较 NNUE 增量更新与全量计算的评估速度
+static void BenchmarkNNUE(const NNUEEvaluator& nnue, int games) {
+    size_t total;
+    auto records = RandomGames(games, total);
+    cout << "局面数：" << total << endl;
+
+    for (NNUESimd simd : {NNUE_SCALAR, NNUE_SSE41, NNUE_AVX2}) {
+        if (!NNUEEvaluator::SetSimd(simd)) continue;
+        double seconds[2];
+        long long checksum[2] = {0, 0};
+        for (int incremental = 1; incremental >= 0; --incremental) {
+            auto start = chrono::steady_clock::now();
+            for (const auto& moves : records) {
+                ChessBoard board;
+                board.InitializeBoard();
+                Color player = RED;
+                NNUEAccumulator acc;
+                nnue.Refresh(acc, board);
+                for (const auto& move : moves) {
+                    ChessPiece moved = *board.GetPiece(move.first.first, move.first.second);
+                    ChessPiece captured = board.MakeMove(move.first.first, move.first.second, move.second.first, move.second.second);
+                    player = (player == RED) ? BLACK : RED;
+                    if (incremental) {
+                        nnue.ApplyMove(acc, board, move.first.first, move.first.second, move.second.first, move.second.second, moved, captured);
+                        checksum[incremental] += nnue.Evaluate(acc, player);
+                    } else {
+                        checksum[incremental] += nnue.Evaluate(board, player);
+                    }
+                }
+            }
+            seconds[incremental] = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+        cout << NNUEEvaluator::SimdName(simd) << "：增量 " << (long long)(total / seconds[1]) << " 次/秒，全量 "
+             << (long long)(total / seconds[0]) << " 次/秒，加速 " << seconds[0] / seconds[1] << " 倍"
+             << (checksum[0] == checksum[1] ? "" : "（结果不一致）") << endl;
+    }
+}
+
+// 比较各指令集下子节点选择的速度，开局局面共 44 个子节点
+static void BenchmarkSelect(int rounds) {
+    MCTSNode root(ChessBoard(), RED);
+    root.Expand();
+    srand(1);
+    int total = 0;
+    for (auto child : root.children) {
+        int visits = rand() % 200;
+        child->SetStats(visits, (rand() % 2001 - 1000) / 1000.0 * visits);
+        total += visits;
+    }
+    root.SetStats(total, 0);
+    cout << "子节点数：" << root.children.size() << endl;
+
+    for (bool usePUCT : {false, true}) {
+        for (NNUESimd simd : {NNUE_SCALAR, NNUE_SSE41, NNUE_AVX2}) {
+            if (!MCTSNode::SetSelectSimd(simd)) continue;
+            fill(root.stats.virtualLoss.begin(), root.stats.virtualLoss.end(), 0.0f);
+            long long checksum = 0;
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < rounds; ++i) checksum += root.SelectBestChild(usePUCT)->index;
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cout << (usePUCT ? "PUCT " : "UCB1 ") << NNUEEvaluator::SimdName(simd) << "：" << (long long)(rounds / seconds)
+                 << " 次/秒，校验和 " << checksum << endl;
+        }
+    }
+}
+
+// 比较批量走法生成与逐个局面生成的速度
+static void BenchmarkMoveGen(int games, int threadNum) {
+    size_t total;
+    auto records = RandomGames(games, total);
+    vector<ChessBoard> boards;
+    vector<Color> players;
+    BoardBatch batch;
+    batch.Reserve(total);
+    for (const auto& moves : records) {
+        ChessBoard board;
+        board.InitializeBoard();
+        Color player = RED;
+        for (const auto& move : moves) {
+            board.MakeMove(move.first.first, move.first.second, move.second.first, move.second.second);
+            player = (player == RED) ? BLACK : RED;
+            boards.push_back(board);
+            players.push_back(player);
+            batch.Add(board, player);
+        }
+    }
+    cout << "局面数：" << total << endl;
+
+    auto start = chrono::steady_clock::now();
+    size_t single = 0;
+    for (size_t i = 0; i < boards.size(); ++i) single += boards[i].GenerateMoves(players[i]).size();
+    double singleSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    MoveBatch result;
+    batch.GenerateMoves(result, threadNum);
+    double batchSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "逐个生成：" << (long long)(total / singleSeconds) << " 局面/秒，批量生成：" << (long long)(total / batchSeconds)
+         << " 局面/秒，加速 " << singleSeconds / batchSeconds << " 倍"
+         << (single == result.moves.size() ? "" : "（走法数不一致）") << endl;
+}
+
+// 搜索树校验和：按深度优先顺序累计各子节点的走法、访问次数与得分
+static uint64_t TreeChecksum(const MCTSNode* node, uint64_t hash) {
+    for (size_t i = 0; i < node->children.size(); ++i) {
+        uint32_t scoreBits;
+        memcpy(&scoreBits, &node->stats.totalScore[i], sizeof(scoreBits));
+        for (uint64_t value : {(uint64_t)node->stats.moves[i], (uint64_t)(uint32_t)node->stats.visits[i], (uint64_t)scoreBits}) {
+            hash = (hash ^ value) * 1099511628211ULL;
+        }
+        hash = TreeChecksum(node->children[i], hash);
+    }
+    return hash;
+}
+
+// 在固定局面集上以确定性方式搜索，每个局面输出最佳走法、访问次数与搜索树校验和
+// write 为 true 时把结果写入 goldenPath 作为新的基准，否则与 goldenPath 逐行比较，返回不一致的行数
+// 基准文件不存在时返回 1，防止回归被当作新基准静默记录
+// evaluator 不为空时以价值头代替随机模拟
+static int GoldenSearch(const char* goldenPath, bool write, int iterations, int threadNum, unsigned seed, size_t maxNodes, Evaluator* evaluator) {
+    // 局面集：初始局面与固定种子随机对局第 10、20、30 步的局面
+    vector<pair<ChessBoard, Color>> positions;
+    positions.push_back({ChessBoard(), RED});
+    size_t total;
+    for (const auto& moves : RandomGames(4, total)) {
+        ChessBoard board;
+        board.InitializeBoard();
+        Color player = RED;
+        for (size_t ply = 0; ply < moves.size() && ply < 30; ++ply) {
+            const auto& move = moves[ply];
+            board.MakeMove(move.first.first, move.first.second, move.second.first, move.second.second);
+            player = (player == RED) ? BLACK : RED;
+            if ((ply + 1) % 10 == 0 && ChessBoard::IsGameOver(board, player) == NOT_OVER) positions.push_back({board, player});
+        }
+    }
+
+    vector<string> lines;
+    ostringstream header;
+    header << "seed " << seed << " threads " << threadNum << " playouts " << iterations;
+    if (maxNodes > 0) header << " nodes " << maxNodes;
+    if (evaluator) header << " net";
+    lines.push_back(header.str());
+    cout << header.str() << "，局面数：" << positions.size() << endl;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < positions.size(); ++i) {
+        MCTSAI ai(positions[i].first, positions[i].second);
+        ai.SetSeed(seed);
+        ai.SetNodeLimit(maxNodes);
+        if (evaluator) ai.SetEvaluator(evaluator);
+        ai.ParallelRun(iterations, threadNum);
+        auto best = ai.GetBestMove();
+        int bestVisits = 0;
+        for (auto child : ai.root->children) {
+            if (child->GetLastMove() == best) bestVisits = child->VisitCount();
+        }
+        ostringstream line;
+        line << i << " " << FormatMove(best) << " " << bestVisits << "/" << ai.root->VisitCount()
+             << " " << hex << TreeChecksum(ai.root, 14695981039346656037ULL);
+        lines.push_back(line.str());
+        cout << line.str() << endl;
+    }
+    cout << "用时：" << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "秒" << endl;
+
+    if (write) {
+        ofstream out(goldenPath);
+        for (const auto& line : lines) out << line << "\n";
+        if (!out.good()) {
+            cout << "无法写入基准结果：" << goldenPath << endl;
+            return 1;
+        }
+        cout << "已写入基准结果：" << goldenPath << endl;
+        return 0;
+    }
+    ifstream in(goldenPath);
+    if (!in.is_open()) {
+        cout << "无法读取基准结果：" << goldenPath << "，使用 --golden-write 生成" << endl;
+        return 1;
+    }
+    int mismatches = 0;
+    string expected;
+    for (const auto& line : lines) {
+        if (!getline(in, expected)) expected.clear();
+        if (line == expected) continue;
+        mismatches++;
+        cout << "不一致：期望 \"" << expected << "\"，实际 \"" << line << "\"" << endl;
+    }
+    if (getline(in, expected)) {
+        mismatches++;
+        cout << "基准结果多出局面：" << expected << endl;
+    }
+    cout << (mismatches == 0 ? "与基准结果一致" : "与基准结果不一致") << endl;
+    return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+    const char* recordPath = nullptr; // 对局记录输出文件
+    const char* treePath = nullptr;   // 热启动搜索树文件
+    const char* bookPath = nullptr;   // 开局库文件
+    const char* buildBookPath = nullptr; // 生成开局库的输出文件
+    const char* gamesPath = nullptr;  // 生成开局库使用的对局记录
+    int selfPlayGames = 0;            // 生成开局库的自我对弈局数
+    int bookPly = 20;                 // 开局库深度
+    const char* tablebasePath = nullptr;    // 残局库目录
+    const char* genTablebasePath = nullptr; // 生成残局库的输出目录
+    const char* goldenPath = nullptr; // 确定性搜索基准结果文件
+    bool goldenWrite = false;         // 写入新的基准结果而不是比较
+    const char* networkPath = nullptr; // 策略/价值网络权重文件，"random" 表示固定种子随机初始化
+    bool networkRollouts = false;     // 使用网络时保留随机模拟，仅使用策略先验
+    const char* nnuePath = nullptr;   // NNUE 权重文件，"material" 表示按子力价值初始化
+    int benchGames = 0;               // NNUE 评估速度测试的对局数
+    int benchMoveGenGames = 0;        // 批量走法生成速度测试的对局数
+    int benchSelectRounds = 0;        // 子节点选择速度测试的次数
+    size_t maxNodes = 0;              // MCTS 搜索树节点数上限，0 表示不限制
+    double stopShare = 0;             // 最佳走法访问占比稳定超过该值时提前结束搜索，0 表示不启用
+    bool serverMode = false;          // 多对局引擎服务模式，从标准输入读取命令
+    SchedulePolicy policy = SCHEDULE_FAIR; // 服务模式的会话调度策略
+    GameConfig config;                // 对局与搜索配置
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (strcmp(argv[i], "--tree") == 0 && i + 1 < argc) treePath = argv[++i];
+        else if (strcmp(argv[i], "--book") == 0 && i + 1 < argc) bookPath = argv[++i];
+        else if (strcmp(argv[i], "--build-book") == 0 && i + 1 < argc) buildBookPath = argv[++i];
+        else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) gamesPath = argv[++i];
+        else if (strcmp(argv[i], "--selfplay") == 0 && i + 1 < argc) selfPlayGames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--playouts") == 0 && i + 1 < argc) config.limits.iterations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--book-ply") == 0 && i + 1 < argc) bookPly = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tb") == 0 && i + 1 < argc) tablebasePath = argv[++i];
+        else if (strcmp(argv[i], "--gen-tb") == 0 && i + 1 < argc) genTablebasePath = argv[++i];
+        else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            config.engine = strcmp(argv[++i], "alphabeta") == 0 ? ENGINE_ALPHABETA : ENGINE_MCTS;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) config.limits.threadNum = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) config.limits.depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) config.limits.timeMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc) config.clockMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--inc") == 0 && i + 1 < argc) config.incrementMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--progress") == 0 && i + 1 < argc) config.progressMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) config.hashSizeMB = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--net") == 0 && i + 1 < argc) networkPath = argv[++i];
+        else if (strcmp(argv[i], "--rollouts") == 0) networkRollouts = true;
+        else if (strcmp(argv[i], "--nnue") == 0 && i + 1 < argc) nnuePath = argv[++i];
+        else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc) maxNodes = atol(argv[++i]);
+        else if (strcmp(argv[i], "--cutoff") == 0 && i + 1 < argc) MCTSNode::playoutCutoff = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench-nnue") == 0 && i + 1 < argc) benchGames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench-movegen") == 0 && i + 1 < argc) benchMoveGenGames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench-select") == 0 && i + 1 < argc) benchSelectRounds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--stop-share") == 0 && i + 1 < argc) stopShare = atof(argv[++i]);
+        else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) goldenPath = argv[++i];
+        else if (strcmp(argv[i], "--golden-write") == 0 && i + 1 < argc) {
+            goldenPath = argv[++i];
+            goldenWrite = true;
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) config.seed = (unsigned)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--server") == 0) serverMode = true;
+        else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            ++i;
+            policy = strcmp(argv[i], "priority") == 0 ? SCHEDULE_PRIORITY : (strcmp(argv[i], "deadline") == 0 ? SCHEDULE_DEADLINE : SCHEDULE_FAIR);
+        }
+    }
+
+    if (buildBookPath) {
+        // 生成开局库
+        OpeningBookBuilder builder(bookPly);
+        if (gamesPath) {
+            GameRecordFile file;
+            if (file.Open(gamesPath)) builder.AddRecordFile(file);
+            else cout << "无法读取对局记录：" << gamesPath << endl;
+        }
+        if (selfPlayGames > 0) {
+            srand(config.seed ? config.seed : time(nullptr));
+            builder.SelfPlay(selfPlayGames, config.limits.iterations, config.limits.threadNum, config.seed);
+        }
+        if (!builder.Write(buildBookPath)) {
+            cout << "无法写入开局库：" << buildBookPath << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (genTablebasePath) {
+        // 生成常见残局：车胜单将、马对单士、炮士对单将
+        EndgameTablebase tablebase;
+        const char* signatures[] = {"KRK", "KHKA", "KCAK"};
+        for (const char* signature : signatures) {
+            if (!tablebase.Generate(signature)) {
+                cout << "无法生成残局库：" << signature << endl;
+                return 1;
+            }
+        }
+        if (!tablebase.Save(genTablebasePath)) {
+            cout << "无法写入残局库：" << genTablebasePath << endl;
+            return 1;
+        }
+        cout << "已生成残局表 " << tablebase.TableCount() << " 张" << endl;
+        return 0;
+    }
+
+    if (benchSelectRounds > 0) {
+        BenchmarkSelect(benchSelectRounds);
+        return 0;
+    }
+
+    if (benchMoveGenGames > 0) {
+        BenchmarkMoveGen(benchMoveGenGames, config.limits.threadNum);
+        return 0;
+    }
+
+    NNUEEvaluator nnue;
+    if (nnuePath && strcmp(nnuePath, "material") != 0 && !nnue.Load(nnuePath)) {
+        cout << "无法读取 NNUE 权重：" << nnuePath << "，使用子力价值初始化" << endl;
+    }
+    if (benchGames > 0) {
+        BenchmarkNNUE(nnue, benchGames);
+        return 0;
+    }
+    // 模拟达到截断步数后使用 NNUE 评估
+    if (nnuePath) MCTSNode::nnue = &nnue;
+
+    EndgameTablebase tablebase;
+    if (tablebasePath && tablebase.Load(tablebasePath) > 0) MCTSNode::tablebase = &tablebase;
+
+    if (goldenPath) {
+        // 相同的种子、线程数与模拟次数应得到与基准结果相同的搜索树
+        // --net random 时网络按种子初始化，批量评估的结果与样本在批次中的位置无关
+        unsigned seed = config.seed ? config.seed : 1;
+        BatchedEvaluator* evaluator = nullptr;
+        if (networkPath) {
+            PolicyValueNet* network = new PolicyValueNet();
+            if (strcmp(networkPath, "random") == 0) network->Initialize(seed);
+            else if (!network->Load(networkPath)) {
+                cout << "无法读取网络权重：" << networkPath << endl;
+                delete network;
+                return 1;
+            }
+            evaluator = new BatchedEvaluator(network, min(config.limits.threadNum, 8));
+        }
+        int mismatches = GoldenSearch(goldenPath, goldenWrite, config.limits.iterations, config.limits.threadNum, seed, maxNodes, evaluator);
+        delete evaluator;
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    if (serverMode) {
+        // 各会话共享 --threads 个工作线程，new 命令未指定时使用 --playouts
+        EngineServer server(config.limits.threadNum, policy);
+        server.Serve(cin, cout, config.limits.iterations);
+        return 0;
+    }
+
+    ChessGame game(new ChessBoard(), config);
+    MCTSAI* ai = dynamic_cast<MCTSAI*>(game.engine);
+    BatchedEvaluator* evaluator = nullptr;
+    if (networkPath && ai) {
+        // 各搜索线程的叶子评估合并成批执行
+        PolicyValueNet* network = new PolicyValueNet();
+        if (strcmp(networkPath, "random") != 0 && !network->Load(networkPath)) {
+            cout << "无法读取网络权重：" << networkPath << "，使用随机初始化" << endl;
+        }
+        evaluator = new BatchedEvaluator(network, min(config.limits.threadNum, 8));
+        ai->SetEvaluator(evaluator, !networkRollouts);
+    }
+    // 长对局中搜索树在上限内回收复用，内存占用不随对局增长
+    if (maxNodes > 0 && ai) ai->SetNodeLimit(maxNodes);
+    if (stopShare > 0 && ai) {
+        // 最佳走法连续多次不变且占比足够高时认为结果已稳定
+        pair<pair<int, int>, pair<int, int>> lastBest;
+        int stableCount = 0;
+        ai->SetSnapshotCallback([stopShare, lastBest, stableCount](const SearchSnapshot& snapshot) mutable {
+            stableCount = snapshot.bestMove == lastBest ? stableCount + 1 : 0;
+            lastBest = snapshot.bestMove;
+            return stableCount < 5 || snapshot.share < stopShare;
+        }, 100);
+    }
+    if (treePath && ai) {
+        // 使用文件中最后一棵根局面与当前局面相同的搜索树热启动
+        GameRecordFile file;
+        if (file.Open(treePath)) {
+            for (size_t i = file.RecordCount(); i > 0; --i) {
+                if (file.GetType(i - 1) == RECORD_TREE && file.LoadTree(i - 1, *ai)) break;
+            }
+        }
+    }
+    GameRecordWriter recorder;
+    if (recordPath && recorder.Open(recordPath)) game.SetRecorder(&recorder);
+    OpeningBook book;
+    if (bookPath && book.Open(bookPath)) game.SetOpeningBook(&book);
     game.Start();
+    delete evaluator;
     return 0;
     // srand(time(nullptr));
 
@@ -1,13 +1,176 @@
 #include "mcts.h"
+#include <immintrin.h>
+#include <random>
+#include "record.h"
+
+const EndgameTablebase* MCTSNode::tablebase = nullptr;
+const NNUEEvaluator* MCTSNode::nnue = nullptr;
+int MCTSNode::playoutCutoff = 16;
+
+#define UCB1_WEIGHT 1.414f // UCB1 探索系数
+#define PUCT_WEIGHT 1.5f   // PUCT 探索系数
+
+// 选择内核按 relaxed 语义直接读取统计量（可被并发的反向传播修改），不参与 TSan 检查
+#define RELAXED_READS __attribute__((no_sanitize_thread))
+
+static inline float AtomicLoad(const float* slot) {
+    float value;
+    __atomic_load(slot, &value, __ATOMIC_RELAXED);
+    return value;
+}
+
+static inline void AtomicAdd(float* slot, float value) {
+    float expected = AtomicLoad(slot);
+    float desired;
+    do {
+        desired = expected + value;
+    } while (!__atomic_compare_exchange(slot, &expected, &desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// 各搜索线程独立的随机数发生器，不共享 rand() 的全局状态与锁
+static thread_local mt19937 searchRandom(random_device{}());
+
+// 在 count 个子节点中选出得分最高者，得分相同时取下标最小者
+// UCB1：未访问节点得分为无穷大，否则为 Q + explore / sqrt(n) + virtualLoss，explore = w * sqrt(ln N)
+// PUCT：Q + explore * prior / (1 + n) + virtualLoss，未访问节点 Q 按 0 计，explore = c * sqrt(N)
+typedef int (*SelectKernel)(const ChildStats& stats, int count, float explore, bool usePUCT);
+
+RELAXED_READS
+static inline float ChildScore(const ChildStats& stats, int i, float explore, bool usePUCT) {
+    float visits = (float)__atomic_load_n(&stats.visits[i], __ATOMIC_RELAXED);
+    float value = visits == 0 ? 0 : AtomicLoad(&stats.totalScore[i]) / visits;
+    float loss = AtomicLoad(&stats.virtualLoss[i]);
+    if (usePUCT) return value + explore * stats.prior[i] / (1 + visits) + loss;
+    if (visits == 0) return INFINITY;
+    return value + explore / sqrt(visits) + loss;
+}
+
+RELAXED_READS
+static int SelectScalar(const ChildStats& stats, int count, float explore, bool usePUCT) {
+    int best = 0;
+    float bestScore = -INFINITY;
+    for (int i = 0; i < count; ++i) {
+        float score = ChildScore(stats, i, explore, usePUCT);
+        if (score > bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// 各车道分别记录最大值及其下标，最后取最大值中下标最小的车道，尾部按标量处理
+RELAXED_READS
+static int ReduceLanes(const float* scores, const int32_t* indices, int lanes, const ChildStats& stats, int begin, int count, float explore, bool usePUCT) {
+    int best = 0;
+    float bestScore = -INFINITY;
+    for (int k = 0; k < lanes; ++k) {
+        if (scores[k] > bestScore || (scores[k] == bestScore && indices[k] < best)) {
+            bestScore = scores[k];
+            best = indices[k];
+        }
+    }
+    for (int i = begin; i < count; ++i) {
+        float score = ChildScore(stats, i, explore, usePUCT);
+        if (score > bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+__attribute__((target("sse4.1"))) RELAXED_READS
+static int SelectSse41(const ChildStats& stats, int count, float explore, bool usePUCT) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1);
+    const __m128 infinity = _mm_set1_ps(INFINITY);
+    const __m128 c = _mm_set1_ps(explore);
+    __m128 best = _mm_set1_ps(-INFINITY);
+    __m128i bestIndex = _mm_setzero_si128();
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 visits = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(stats.visits.data() + i)));
+        __m128 unvisited = _mm_cmpeq_ps(visits, zero);
+        __m128 value = _mm_andnot_ps(unvisited, _mm_div_ps(_mm_loadu_ps(stats.totalScore.data() + i), _mm_max_ps(visits, one)));
+        __m128 score = _mm_add_ps(value, _mm_loadu_ps(stats.virtualLoss.data() + i));
+        if (usePUCT) {
+            score = _mm_add_ps(score, _mm_div_ps(_mm_mul_ps(c, _mm_loadu_ps(stats.prior.data() + i)), _mm_add_ps(visits, one)));
+        } else {
+            score = _mm_add_ps(score, _mm_div_ps(c, _mm_sqrt_ps(_mm_max_ps(visits, one))));
+            score = _mm_blendv_ps(score, infinity, unvisited);
+        }
+        __m128 better = _mm_cmpgt_ps(score, best);
+        best = _mm_blendv_ps(best, score, better);
+        bestIndex = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(bestIndex), _mm_castsi128_ps(index), better));
+        index = _mm_add_epi32(index, _mm_set1_epi32(4));
+    }
+    float scores[4];
+    int32_t indices[4];
+    _mm_storeu_ps(scores, best);
+    _mm_storeu_si128((__m128i*)indices, bestIndex);
+    return ReduceLanes(scores, indices, 4, stats, i, count, explore, usePUCT);
+}
+
+__attribute__((target("avx2"))) RELAXED_READS
+static int SelectAvx2(const ChildStats& stats, int count, float explore, bool usePUCT) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1);
+    const __m256 infinity = _mm256_set1_ps(INFINITY);
+    const __m256 c = _mm256_set1_ps(explore);
+    __m256 best = _mm256_set1_ps(-INFINITY);
+    __m256i bestIndex = _mm256_setzero_si256();
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 visits = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(stats.visits.data() + i)));
+        __m256 unvisited = _mm256_cmp_ps(visits, zero, _CMP_EQ_OQ);
+        __m256 value = _mm256_andnot_ps(unvisited, _mm256_div_ps(_mm256_loadu_ps(stats.totalScore.data() + i), _mm256_max_ps(visits, one)));
+        __m256 score = _mm256_add_ps(value, _mm256_loadu_ps(stats.virtualLoss.data() + i));
+        if (usePUCT) {
+            score = _mm256_add_ps(score, _mm256_div_ps(_mm256_mul_ps(c, _mm256_loadu_ps(stats.prior.data() + i)), _mm256_add_ps(visits, one)));
+        } else {
+            score = _mm256_add_ps(score, _mm256_div_ps(c, _mm256_sqrt_ps(_mm256_max_ps(visits, one))));
+            score = _mm256_blendv_ps(score, infinity, unvisited);
+        }
+        __m256 better = _mm256_cmp_ps(score, best, _CMP_GT_OQ);
+        best = _mm256_blendv_ps(best, score, better);
+        bestIndex = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestIndex), _mm256_castsi256_ps(index), better));
+        index = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+    }
+    float scores[8];
+    int32_t indices[8];
+    _mm256_storeu_ps(scores, best);
+    _mm256_storeu_si256((__m256i*)indices, bestIndex);
+    return ReduceLanes(scores, indices, 8, stats, i, count, explore, usePUCT);
+}
+
+static NNUESimd selectSimd = __builtin_cpu_supports("avx2") ? NNUE_AVX2 : (__builtin_cpu_supports("sse4.1") ? NNUE_SSE41 : NNUE_SCALAR);
+static SelectKernel selectKernel = selectSimd == NNUE_AVX2 ? SelectAvx2 : (selectSimd == NNUE_SSE41 ? SelectSse41 : SelectScalar);
+
+NNUESimd MCTSNode::GetSelectSimd() {
+    return selectSimd;
+}
+
+bool MCTSNode::SetSelectSimd(NNUESimd simd) {
+    if (!NNUEEvaluator::IsSupported(simd)) return false;
+    selectSimd = simd;
+    selectKernel = simd == NNUE_AVX2 ? SelectAvx2 : (simd == NNUE_SSE41 ? SelectSse41 : SelectScalar);
+    return true;
+}
 
 MCTSNode::MCTSNode(const ChessBoard& board, Color currentPlayer, MCTSNode* parent){
     this->board = board;
     this->board.name = "in chessboard";
     this->currentPlayer = currentPlayer;
     this->parent = parent;
-    this->visitCount.store(0);
-    this->totalScore.store(0);
-    this->virtualLoss.store(0);
+    this->index = 0;
+    this->rootVisits = 0;
+    this->rootScore = 0;
+    this->rootVirtualLoss = 0;
+    this->expanded.store(false);
+    this->lastVisit = 0;
 }
 
 MCTSNode::~MCTSNode() {
@@ -18,7 +181,7 @@ MCTSNode::~MCTSNode() {
 
 // 判断是否为叶子节点
 bool MCTSNode::IsLeaf() const {
-    return children.empty();
+    return !expanded.load(memory_order_acquire);
 }
 
 // 判断是否为根节点
@@ -26,87 +189,159 @@ bool MCTSNode::IsRoot() const {
     return parent == nullptr;
 }
 
-// 计算 UCB1 值
-double MCTSNode::UCB1(double explorationWeight) const{
-    if (visitCount == 0) return numeric_limits<double>::max();
-    return (totalScore.load() / visitCount.load()) + explorationWeight * sqrt(log(parent->visitCount.load()) / visitCount.load()) + virtualLoss.load();
+int32_t* MCTSNode::VisitSlot() {
+    return parent ? &parent->stats.visits[index] : &rootVisits;
+}
+
+float* MCTSNode::ScoreSlot() {
+    return parent ? &parent->stats.totalScore[index] : &rootScore;
+}
+
+float* MCTSNode::VirtualLossSlot() {
+    return parent ? &parent->stats.virtualLoss[index] : &rootVirtualLoss;
+}
+
+int MCTSNode::VisitCount() const {
+    return __atomic_load_n(parent ? &parent->stats.visits[index] : &rootVisits, __ATOMIC_RELAXED);
+}
+
+double MCTSNode::TotalScore() const {
+    return AtomicLoad(parent ? &parent->stats.totalScore[index] : &rootScore);
+}
+
+float MCTSNode::Prior() const {
+    return parent ? parent->stats.prior[index] : 1.0f;
+}
+
+void MCTSNode::SetStats(int visits, double totalScore) {
+    __atomic_store_n(VisitSlot(), visits, __ATOMIC_RELAXED);
+    float score = totalScore;
+    __atomic_store(ScoreSlot(), &score, __ATOMIC_RELAXED);
+}
+
+void MCTSNode::Detach() {
+    if (IsRoot()) return;
+    rootVisits = VisitCount();
+    rootScore = TotalScore();
+    rootVirtualLoss = AtomicLoad(VirtualLossSlot());
+    parent = nullptr;
+    index = 0;
 }
 
 // 选择最佳子节点
-MCTSNode* MCTSNode::SelectBestChild() {
+MCTSNode* MCTSNode::SelectBestChild(bool usePUCT) {
     lock_guard<mutex> lock(mtx);
-    MCTSNode* bestChild = *max_element(children.begin(), children.end(), [](MCTSNode* a, MCTSNode* b) {
-        return a->UCB1() < b->UCB1();
-    });
-    bestChild->virtualLoss.store(bestChild->virtualLoss.load() - 1);
-    return bestChild;
+    int visits = VisitCount();
+    float explore = usePUCT ? PUCT_WEIGHT * sqrt((float)visits) : (visits > 0 ? UCB1_WEIGHT * sqrt(log((float)visits)) : 0);
+    int best = selectKernel(stats, children.size(), explore, usePUCT);
+    AtomicAdd(&stats.virtualLoss[best], -1);
+    return children[best];
 }
 
 // 扩展子节点
-void MCTSNode::Expand() {
-    lock_guard<mutex> lock(mtx);
-    if (!IsLeaf()) return;
+int MCTSNode::Expand() {
     vector<pair<pair<int, int>, pair<int, int>>> moves = GenerateLegalMoves(board, currentPlayer);
-    for (const auto& move : moves) {
-        ChessBoard newBoard = board;
-        newBoard.MovePiece(move.first.first, move.first.second, move.second.first, move.second.second);
-        MCTSNode* child = new MCTSNode(newBoard, (currentPlayer == RED) ? BLACK : RED, this);
-        child->lastMove = move; // 记录移动
-        children.push_back(child);
+    return Expand(moves, vector<float>(moves.size(), moves.empty() ? 0.0f : 1.0f / moves.size()));
+}
+
+int MCTSNode::Expand(const vector<pair<pair<int, int>, pair<int, int>>>& moves, const vector<float>& priors) {
+    lock_guard<mutex> lock(mtx);
+    if (!IsLeaf()) return 0;
+    // 残局库已知结果的局面不再展开，由 Simulate 直接给出精确值
+    if (!IsRoot() && ProbeTablebase(board, currentPlayer) != NOT_OVER) return 0;
+    children.reserve(moves.size());
+    for (size_t i = 0; i < moves.size(); ++i) {
+        AddChild(moves[i], priors[i]);
     }
+    return children.size();
+}
+
+size_t MCTSNode::Collapse() {
+    size_t removed = 0;
+    for (auto child : children) {
+        removed += child->Collapse() + 1;
+        delete child;
+    }
+    children = vector<MCTSNode*>();
+    stats = ChildStats();
+    expanded.store(false);
+    return removed;
+}
+
+// 统计量先于子节点指针写入，读到子节点时其统计量已存在
+// 其他线程不加锁通过 expanded 判断是否为叶子，完整的子节点列表仍需在锁内读取
+MCTSNode* MCTSNode::AddChild(const pair<pair<int, int>, pair<int, int>>& move, float prior) {
+    ChessBoard newBoard = board;
+    newBoard.MovePiece(move.first.first, move.first.second, move.second.first, move.second.second);
+    MCTSNode* child = new MCTSNode(newBoard, (currentPlayer == RED) ? BLACK : RED, this);
+    child->lastMove = move; // 记录移动
+    child->index = children.size();
+    stats.visits.push_back(0);
+    stats.totalScore.push_back(0);
+    stats.virtualLoss.push_back(0);
+    stats.prior.push_back(prior);
+    stats.moves.push_back(EncodeMove(move));
+    children.push_back(child);
+    expanded.store(true, memory_order_release);
+    return child;
 }
 
 // 随机模拟游戏
-double MCTSNode::Simulate() {
+double MCTSNode::Simulate(PositionHistory& history) {
     ChessBoard simBoard = board;
     Color simPlayer = currentPlayer;
     GameResult result = IsGameOver(simBoard, simPlayer);
+    if (result == NOT_OVER) result = ProbeTablebase(simBoard, simPlayer);
     int noEatCount = 0;
+    NNUEAccumulator acc;
+    if (nnue) nnue->Refresh(acc, simBoard);
+    int ply = 0;
     while (result == NOT_OVER) {
+        if (nnue && ply >= playoutCutoff) {
+            // 截断模拟，按行棋方评估换算为 currentPlayer 的对手视角得分
+            float value = nnue->Value(acc, simPlayer);
+            return simPlayer == currentPlayer ? -value : value;
+        }
         vector<pair<pair<int, int>, pair<int, int>>> moves = GenerateLegalMoves(simBoard, simPlayer);
         if (moves.empty()) break;
-        auto randomMove = moves[rand() % moves.size()];
-        if (simBoard.GetPiece(randomMove.second.first, randomMove.second.second)->type == EMPTY) noEatCount++;
+        auto randomMove = moves[searchRandom() % moves.size()];
+        bool capture = simBoard.GetPiece(randomMove.second.first, randomMove.second.second)->type != EMPTY;
+        if (!capture) noEatCount++;
         else noEatCount = 0;
         if (noEatCount >= 40){
             result = DRAW;
             break;
         }
-        simBoard.MovePiece(randomMove.first.first, randomMove.first.second, randomMove.second.first, randomMove.second.second);
+        bool irreversible = PositionHistory::IsIrreversible(simBoard, randomMove);
+        ChessPiece moved = *simBoard.GetPiece(randomMove.first.first, randomMove.first.second);
+        ChessPiece captured = simBoard.MakeMove(randomMove.first.first, randomMove.first.second, randomMove.second.first, randomMove.second.second);
+        if (nnue) nnue->ApplyMove(acc, simBoard, randomMove.first.first, randomMove.first.second, randomMove.second.first, randomMove.second.second, moved, captured);
+        ply++;
         // cout << "move:" << randomMove.first.first << "," << randomMove.first.second << "->" << randomMove.second.first << "," << randomMove.second.second << endl;
         // cout << "noEatCount:" << noEatCount << endl;
         simPlayer = (simPlayer == RED) ? BLACK : RED;
         // simBoard.Print();
         result = IsGameOver(simBoard, simPlayer);
+        history.Push(simBoard.GetHash(simPlayer), randomMove, irreversible);
+        // 出现循环局面时提前结束
+        if (result == NOT_OVER && !irreversible) result = history.CheckRepetition(simBoard);
+        // 子力变化后查询残局库
+        if (result == NOT_OVER && capture) result = ProbeTablebase(simBoard, simPlayer);
     }
     return EvaluateBoard(result, currentPlayer);
 }
 
 // 回溯更新节点
 void MCTSNode::Backpropagate(double score) {
-    visitCount++;
-    totalScore.store(totalScore + score);
-    virtualLoss.store(virtualLoss + 1);
+    __atomic_fetch_add(VisitSlot(), 1, __ATOMIC_RELAXED);
+    AtomicAdd(ScoreSlot(), score);
+    AtomicAdd(VirtualLossSlot(), 1);
     if (!IsRoot()) parent->Backpropagate(-score);
 }
 
 // 生成合法移动
 vector<pair<pair<int, int>, pair<int, int>>> MCTSNode::GenerateLegalMoves(const ChessBoard& board, Color player) {
-    vector<pair<pair<int, int>, pair<int, int>>> moves;
-    for (int row = 0; row < 10; ++row) {
-        for (int col = 0; col < 9; ++col) {
-            if (board.GetPiece(row, col) && board.GetPiece(row, col)->color == player) {
-                for (int targetRow = 0; targetRow < 10; ++targetRow) {
-                    for (int targetCol = 0; targetCol < 9; ++targetCol) {
-                        if (board.IsValidMove(row, col, targetRow, targetCol)) {
-                            moves.push_back({{row, col}, {targetRow, targetCol}});
-                        }
-                    }
-                }
-            }
-        }
-    }
-    return moves;
+    return board.GenerateMoves(player);
 }
 
 // 判断游戏是否结束
@@ -119,12 +354,26 @@ double MCTSNode::EvaluateBoard(GameResult result, Color currentPlayer) {
     if (result == BLACK_WIN && currentPlayer == BLACK) return -1.0;
     else if (result == RED_WIN && currentPlayer == RED) return -1.0;
     else if (result == RED_WIN && currentPlayer == BLACK) return 1.0;
-    else if (result == BLACK_WIN && currentPlayer == BLACK) return 1.0;
+    else if (result == BLACK_WIN && currentPlayer == RED) return 1.0;
     else if (result == DRAW) return 0.0;
     else return 0.0;
     
 }
 
+// 查询残局库
+GameResult MCTSNode::ProbeTablebase(const ChessBoard& board, Color currentPlayer) {
+    TablebaseResult result;
+    if (tablebase == nullptr || !tablebase->Probe(board, currentPlayer, result)) return NOT_OVER;
+    if (result.wdl == 0) return DRAW;
+    Color winner = result.wdl > 0 ? currentPlayer : ((currentPlayer == RED) ? BLACK : RED);
+    return winner == RED ? RED_WIN : BLACK_WIN;
+}
+
+void MCTSNode::SeedRandom(unsigned seed, unsigned stream) {
+    seed_seq seq{seed, stream};
+    searchRandom.seed(seq);
+}
+
 // 打印节点对应棋盘
 void MCTSNode::Print(){
     board.Print();
@@ -135,17 +384,55 @@ pair<pair<int, int>, pair<int, int>> MCTSNode::GetLastMove() const {
     return lastMove;
 }
 
-MCTSAI::MCTSAI(){}
+MCTSAI::MCTSAI(){
+    root = nullptr;
+    evaluator = nullptr;
+    useValueHead = false;
+    nodeCount.store(0);
+    nodeLimit = 0;
+    stopping.store(false);
+    snapshotIntervalMs = 1000;
+    seed = 0;
+    visitClock.store(0);
+}
 
 MCTSAI::MCTSAI(const ChessBoard board, Color player) {
     root = new MCTSNode(board, player);
+    history.Reset(board, player);
+    evaluator = nullptr;
+    useValueHead = false;
+    nodeCount.store(1);
+    nodeLimit = 0;
+    stopping.store(false);
+    snapshotIntervalMs = 1000;
+    seed = 0;
+    visitClock.store(0);
 }
 
 MCTSAI::MCTSAI(const MCTSAI &other) {
     root = other.root;
+    history = other.history;
+    evaluator = other.evaluator;
+    useValueHead = other.useValueHead;
+    nodeCount.store(other.nodeCount.load());
+    nodeLimit = other.nodeLimit;
+    stopping.store(false);
+    snapshotCallback = other.snapshotCallback;
+    snapshotIntervalMs = other.snapshotIntervalMs;
+    seed = other.seed;
+    visitClock.store(other.visitClock.load());
 }
 MCTSAI& MCTSAI::operator=(const MCTSAI& other){
     root = other.root;
+    history = other.history;
+    evaluator = other.evaluator;
+    useValueHead = other.useValueHead;
+    nodeCount.store(other.nodeCount.load());
+    nodeLimit = other.nodeLimit;
+    snapshotCallback = other.snapshotCallback;
+    snapshotIntervalMs = other.snapshotIntervalMs;
+    seed = other.seed;
+    visitClock.store(other.visitClock.load());
     return *this;
 }
 MCTSAI::~MCTSAI() {
@@ -154,84 +441,376 @@ MCTSAI::~MCTSAI() {
 
 // 运行 MCTS
 void MCTSAI::Run(int iterations) {
+    RunTree(root, iterations, nodeCount, visitClock, nodeLimit);
+}
+
+void MCTSAI::RunTree(MCTSNode* tree, int iterations, atomic<size_t>& count, atomic<uint32_t>& clock, size_t limit) {
     for (int i = 0; i < iterations; ++i) {
+        if (stopping.load(memory_order_relaxed)) break;
         // cout << "Iteration: " << i + 1 << "/"  << iterations << '\r';
-        MCTSNode* node = Select(root);
+        if (limit > 0 && count.load() >= limit) CollectTree(tree, count, limit);
+        shared_lock<shared_mutex> treeLock(treeMtx);
+        MCTSNode* node = Select(tree, clock.fetch_add(1, memory_order_relaxed));
         if (!node->IsLeaf()) {
-            node = node->SelectBestChild();
+            node = node->SelectBestChild(evaluator != nullptr);
         }
-        if (node->IsGameOver(node->board, node->currentPlayer) == NOT_OVER && node->IsLeaf()) {
-            node->Expand();
-            node = node->children[rand() % node->children.size()];
+        PositionHistory path = BuildPath(node);
+        GameResult result = path.CheckRepetition(node->board);
+        double score;
+        // 回收后节点数仍达到上限时不再展开，直接从叶子模拟
+        bool canExpand = limit == 0 || count.load() < limit;
+        if (result == NOT_OVER && canExpand && node->IsGameOver(node->board, node->currentPlayer) == NOT_OVER && node->IsLeaf()) {
+            if (evaluator != nullptr) {
+                // 评估器展开叶子并给出价值，价值相对行棋方，取反后为到达该节点一方的得分
+                if (!EvaluateLeaf(node, score, count)) score = node->Simulate(path);
+                node->Backpropagate(score);
+                continue;
+            }
+            count += node->Expand();
+            if (!node->IsLeaf()) {
+                MCTSNode* parent = node;
+                node = node->children[searchRandom() % node->children.size()];
+                path.Push(parent->board, node->board, node->currentPlayer, node->lastMove);
+                result = path.CheckRepetition(node->board);
+            }
         }
-        double score = node->Simulate();
+        // 循环局面直接按重复规则计分，不再模拟
+        score = result != NOT_OVER ? MCTSNode::EvaluateBoard(result, node->currentPlayer) : node->Simulate(path);
         node->Backpropagate(score);
     }
 }
 
+// 使用评估器展开叶子
+bool MCTSAI::EvaluateLeaf(MCTSNode* node, double& score, atomic<size_t>& count) {
+    // 残局库已知结果时由 Simulate 给出精确值
+    if (!node->IsRoot() && MCTSNode::ProbeTablebase(node->board, node->currentPlayer) != NOT_OVER) return false;
+    vector<pair<pair<int, int>, pair<int, int>>> moves = node->board.GenerateMoves(node->currentPlayer);
+    EvalRequest request;
+    request.board = &node->board;
+    request.player = node->currentPlayer;
+    request.moves = &moves;
+    evaluator->Evaluate(request);
+    count += node->Expand(moves, request.priors);
+    if (!useValueHead) return false;
+    score = -request.value;
+    return true;
+}
+
+// 生成局面历史
+PositionHistory MCTSAI::BuildPath(MCTSNode* node) {
+    vector<MCTSNode*> nodes;
+    for (MCTSNode* current = node; !current->IsRoot(); current = current->parent) {
+        nodes.push_back(current);
+    }
+    PositionHistory path = history;
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+        path.Push((*it)->parent->board, (*it)->board, (*it)->currentPlayer, (*it)->lastMove);
+    }
+    return path;
+}
+
 // 多线程运行 MCTS
+#define TIME_CHECK_MS 20 // 时间管理检查间隔（毫秒）
+
 void MCTSAI::ParallelRun(int iterations, int threadNum) {
+    RunThreads(iterations / threadNum, threadNum, nullptr);
+}
+
+void MCTSAI::TimedRun(TimeManager& timer, int threadNum) {
+    RunThreads(INT_MAX, threadNum, &timer);
+}
+
+void MCTSAI::RunThreads(int threadIterations, int threadNum, TimeManager* timer) {
+    stopping.store(false);
+    // 按时钟搜索的模拟次数取决于运行速度，不使用确定性方式
+    bool deterministic = seed != 0 && timer == nullptr;
+    vector<MCTSNode*> trees(threadNum, nullptr);
+    uint32_t clockStart = visitClock.load();
     vector<thread> threads;
-    int threadIterations = iterations / threadNum;
+    mutex doneMtx;
+    condition_variable doneCv;
+    int running = threadNum;
     for (int i = 0; i < threadNum; i++)
     {
         threads.push_back(
-            thread(&MCTSAI::Run, this, threadIterations)
+            thread([this, i, threadNum, threadIterations, deterministic, clockStart, &trees, &doneMtx, &doneCv, &running]() {
+                if (!deterministic) {
+                    Run(threadIterations);
+                }
+                else if (i == 0) {
+                    // 主树只由 0 号线程访问，节点数单独统计，搜索结束后重新计数
+                    MCTSNode::SeedRandom(seed, i);
+                    atomic<size_t> count(nodeCount.load());
+                    RunTree(root, threadIterations, count, visitClock, nodeLimit);
+                }
+                else {
+                    MCTSNode::SeedRandom(seed, i);
+                    trees[i] = new MCTSNode(root->board, root->currentPlayer);
+                    atomic<size_t> count(1);
+                    atomic<uint32_t> clock(clockStart);
+                    RunTree(trees[i], threadIterations, count, clock, nodeLimit / threadNum);
+                }
+                lock_guard<mutex> lock(doneMtx);
+                running--;
+                doneCv.notify_one();
+            })
         );
     }
+    if (snapshotCallback || timer) {
+        // 等待搜索线程期间按间隔报告快照，并由时间管理决定何时停止
+        int interval = max(1, snapshotIntervalMs);
+        if (timer) interval = snapshotCallback ? min(interval, TIME_CHECK_MS) : TIME_CHECK_MS;
+        auto lastReport = chrono::steady_clock::now();
+        unique_lock<mutex> lock(doneMtx);
+        while (!doneCv.wait_for(lock, chrono::milliseconds(interval), [&running]() { return running == 0; })) {
+            lock.unlock();
+            SearchSnapshot snapshot = GetSnapshot();
+            bool proceed = timer == nullptr || timer->ShouldContinue(snapshot);
+            auto now = chrono::steady_clock::now();
+            if (snapshotCallback && now - lastReport >= chrono::milliseconds(snapshotIntervalMs)) {
+                lastReport = now;
+                proceed = snapshotCallback(snapshot) && proceed;
+            }
+            if (!proceed) Stop();
+            lock.lock();
+        }
+    }
     for(auto &thread : threads){
         thread.join();
     }
-    
+    if (deterministic) {
+        // 按线程顺序合并，浮点累加顺序固定
+        for (int i = 1; i < threadNum; i++) {
+            MergeTree(root, trees[i]);
+            delete trees[i];
+        }
+        RecountNodes();
+        if (nodeLimit > 0 && nodeCount.load() >= nodeLimit) CollectTree(root, nodeCount, nodeLimit);
+    }
+    if (snapshotCallback) snapshotCallback(GetSnapshot());
+}
+
+void MCTSAI::MergeTree(MCTSNode* dst, const MCTSNode* src) {
+    dst->SetStats(dst->VisitCount() + src->VisitCount(), dst->TotalScore() + src->TotalScore());
+    dst->lastVisit = max(dst->lastVisit, src->lastVisit);
+    for (size_t i = 0; i < src->children.size(); ++i) {
+        size_t j = 0;
+        while (j < dst->children.size() && dst->stats.moves[j] != src->stats.moves[i]) ++j;
+        if (j == dst->children.size()) dst->AddChild(src->children[i]->GetLastMove(), src->stats.prior[i]);
+        MergeTree(dst->children[j], src->children[i]);
+    }
+}
+
+void MCTSAI::Search(const SearchLimits& limits) {
+    seed = limits.seed;
+    if (limits.clockMs > 0) {
+        TimeManager timer(limits.clockMs, limits.incrementMs);
+        TimedRun(timer, limits.threadNum);
+        return;
+    }
+    ParallelRun(limits.iterations, limits.threadNum);
+}
+
+void MCTSAI::Stop() {
+    stopping.store(true);
+}
+
+SearchProgress MCTSAI::GetProgress() const {
+    SearchProgress progress;
+    progress.nodes = root ? root->VisitCount() : 0;
+    return progress;
+}
+
+void MCTSAI::SetNodeLimit(size_t limit) {
+    nodeLimit = limit;
+}
+
+size_t MCTSAI::GetNodeCount() const {
+    return nodeCount.load();
+}
+
+void MCTSAI::SetSeed(unsigned seed) {
+    this->seed = seed;
+}
+
+void MCTSAI::SetSnapshotCallback(SnapshotCallback callback, int intervalMs) {
+    snapshotCallback = callback;
+    snapshotIntervalMs = intervalMs;
+}
+
+MCTSNode* MCTSAI::MostVisitedChild(MCTSNode* node, int& totalVisits, int* secondVisits) {
+    lock_guard<mutex> lock(node->mtx);
+    MCTSNode* best = nullptr;
+    int bestVisits = -1, second = 0;
+    totalVisits = 0;
+    for (size_t i = 0; i < node->children.size(); ++i) {
+        int visits = __atomic_load_n(&node->stats.visits[i], __ATOMIC_RELAXED);
+        totalVisits += visits;
+        if (visits > bestVisits) {
+            second = max(second, bestVisits);
+            best = node->children[i];
+            bestVisits = visits;
+        }
+        else second = max(second, visits);
+    }
+    if (secondVisits) *secondVisits = second;
+    return best;
+}
+
+// 子节点只在展开时加锁追加，逐层加锁读取即可；持有 treeMtx 防止读取期间回收
+SearchSnapshot MCTSAI::GetSnapshot(int maxDepth) const {
+    shared_lock<shared_mutex> treeLock(treeMtx);
+    SearchSnapshot snapshot;
+    snapshot.visits = root->VisitCount();
+    int totalVisits, secondVisits;
+    MCTSNode* best = MostVisitedChild(root, totalVisits, &secondVisits);
+    if (best == nullptr) return snapshot;
+    int visits = best->VisitCount();
+    snapshot.bestMove = best->GetLastMove();
+    snapshot.share = totalVisits > 0 ? (double)visits / totalVisits : 0;
+    snapshot.secondShare = totalVisits > 0 ? (double)secondVisits / totalVisits : 0;
+    snapshot.value = visits > 0 ? best->TotalScore() / visits : 0;
+    for (MCTSNode* node = best; node != nullptr && node->VisitCount() > 0 && (int)snapshot.pv.size() < maxDepth;
+         node = MostVisitedChild(node, totalVisits)) {
+        snapshot.pv.push_back(node->GetLastMove());
+    }
+    return snapshot;
+}
+
+#define GC_TARGET_PERCENT 75 // 回收后的节点数占上限的百分比
+
+// 子孙节点的 lastVisit 不大于祖先，按 lastVisit 升序、深度降序排序时子孙通常先于祖先收缩；
+// 并发写入可能打乱这一顺序，因此收缩前检查祖先是否已被收缩
+void MCTSAI::CollectTree(MCTSNode* tree, atomic<size_t>& count, size_t limit) {
+    unique_lock<shared_mutex> treeLock(treeMtx);
+    // 等待锁期间其他线程可能已完成回收
+    if (count.load() < limit) return;
+    struct Candidate {
+        MCTSNode* node;
+        int parent; // 父节点在 candidates 中的下标，父节点为 tree 时为 -1
+        int depth;
+    };
+    vector<Candidate> candidates;
+    for (auto child : tree->children) {
+        if (!child->IsLeaf()) candidates.push_back({child, -1, 1});
+    }
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        MCTSNode* node = candidates[i].node;
+        int depth = candidates[i].depth;
+        for (auto child : node->children) {
+            if (!child->IsLeaf()) candidates.push_back({child, (int)i, depth + 1});
+        }
+    }
+    vector<int> order(candidates.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    sort(order.begin(), order.end(), [&candidates](int a, int b) {
+        if (candidates[a].node->lastVisit != candidates[b].node->lastVisit) return candidates[a].node->lastVisit < candidates[b].node->lastVisit;
+        if (candidates[a].depth != candidates[b].depth) return candidates[a].depth > candidates[b].depth;
+        return a < b;
+    });
+
+    size_t nodes = count.load();
+    size_t target = limit * GC_TARGET_PERCENT / 100;
+    vector<bool> collapsed(candidates.size(), false);
+    for (int i : order) {
+        if (nodes <= target) break;
+        bool freed = false;
+        for (int p = candidates[i].parent; p >= 0 && !freed; p = candidates[p].parent) freed = collapsed[p];
+        if (freed) continue;
+        nodes -= candidates[i].node->Collapse();
+        collapsed[i] = true;
+    }
+    count.store(nodes);
+}
+
+void MCTSAI::RecountNodes() {
+    nodeCount.store(root ? CountNodes(root) : 0);
+}
+
+size_t MCTSAI::CountNodes(const MCTSNode* node) {
+    size_t count = 1;
+    for (auto child : node->children) count += CountNodes(child);
+    return count;
+}
+
+void MCTSAI::SetEvaluator(Evaluator* evaluator, bool useValueHead) {
+    this->evaluator = evaluator;
+    this->useValueHead = useValueHead;
 }
 
 // 选择最佳移动
 pair<pair<int, int>, pair<int, int>> MCTSAI::GetBestMove() {
-    MCTSNode* bestChild = *max_element(root->children.begin(), root->children.end(), [](MCTSNode* a, MCTSNode* b) {
-        return a->visitCount < b->visitCount;
-    });
-    return bestChild->GetLastMove();
+    // 搜索在第一次模拟前被停止时直接展开根节点
+    if (root->IsLeaf()) nodeCount += root->Expand();
+    int totalVisits;
+    return MostVisitedChild(root, totalVisits)->GetLastMove();
 }
 
 // 选择节点
-MCTSNode* MCTSAI::Select(MCTSNode* node) {
+MCTSNode* MCTSAI::Select(MCTSNode* node, uint32_t tick) {
+    __atomic_store_n(&node->lastVisit, tick, __ATOMIC_RELAXED);
     while (!node->IsLeaf()) {
-        node = node->SelectBestChild();
+        node = node->SelectBestChild(evaluator != nullptr);
+        __atomic_store_n(&node->lastVisit, tick, __ATOMIC_RELAXED);
     }
     return node;
 }
 
 // 更新节点
 void MCTSAI::AutoUpdate() {
+    // 根节点未展开时直接展开，不依赖可能已被停止的 Run
     if (root->children.size() == 0){
-        Run(1);
+        nodeCount += root->Expand();
     }
-    vector<MCTSNode*>::iterator bestChildIterator = max_element(root->children.begin(), root->children.end(), [](MCTSNode* a, MCTSNode* b) {
-        return a->visitCount < b->visitCount;
-    });
-    MCTSNode* bestChild = *bestChildIterator;
-    int bestChildIndex = bestChildIterator - root->children.begin();
+    int totalVisits;
+    MCTSNode* bestChild = MostVisitedChild(root, totalVisits);
+    int bestChildIndex = bestChild->index;
 
+    bestChild->Detach();
     root->children.erase(root->children.begin() + bestChildIndex);
+    history.Push(root->board, bestChild->board, bestChild->currentPlayer, bestChild->lastMove);
     delete root;
     root = bestChild;
-    root->parent = nullptr;
+    RecountNodes();
 }
 
 void MCTSAI::Update(pair<pair<int, int>, pair<int, int>> move) {
     size_t i = 0;
+    // 根节点未展开时直接展开，不依赖可能已被停止的 Run
     if (root->children.size() == 0){
-        Run(1);
+        nodeCount += root->Expand();
     }
+    uint16_t code = EncodeMove(move);
     for(;i < root->children.size();i++){
-        if(root->children[i]->GetLastMove() == move){
+        if(root->stats.moves[i] == code){
             break;
         }
     }
+    if (i == root->children.size()) {
+        // 搜索树中没有该走法（如载入的不完整搜索树），以走子后的局面新建根节点
+        ChessBoard board = root->board;
+        board.MovePiece(move.first.first, move.first.second, move.second.first, move.second.second);
+        Color player = (root->currentPlayer == RED) ? BLACK : RED;
+        history.Push(root->board, board, player, move);
+        delete root;
+        root = new MCTSNode(board, player);
+        root->lastMove = move;
+        nodeCount.store(1);
+        return;
+    }
     MCTSNode* bestChild = root->children[i];
 
+    bestChild->Detach();
     root->children.erase(root->children.begin() + i);
+    history.Push(root->board, bestChild->board, bestChild->currentPlayer, bestChild->lastMove);
     delete root;
     root = bestChild;
-    root->parent = nullptr;
+    RecountNodes();
+}
+
+void MCTSAI::Reset(const ChessBoard& board, Color player) {
+    delete root;
+    root = new MCTSNode(board, player);
+    history.Reset(board, player);
+    nodeCount.store(1);
 }
\ No newline at end of file
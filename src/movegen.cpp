@@ -0,0 +1,237 @@
+#include "movegen.h"
+#include <cstring>
+#include <thread>
+
+// 车道向量：每个元素对应一个局面，比较结果为 0 或 -1
+typedef int8_t LaneMask __attribute__((vector_size(BATCH_LANES)));
+typedef int16_t LaneCount __attribute__((vector_size(BATCH_LANES * 2)));
+
+static inline LaneMask LoadLanes(const uint8_t* data) {
+    LaneMask lanes;
+    memcpy(&lanes, data, sizeof(lanes));
+    return lanes;
+}
+
+static inline bool Any(LaneMask mask) {
+    uint64_t words[BATCH_LANES / 8];
+    memcpy(words, &mask, sizeof(words));
+    uint64_t any = 0;
+    for (uint64_t word : words) any |= word;
+    return any != 0;
+}
+
+size_t MoveBatch::Count(size_t index) const {
+    return offsets[index + 1] - offsets[index];
+}
+
+const uint16_t* MoveBatch::Moves(size_t index) const {
+    return moves.data() + offsets[index];
+}
+
+BoardBatch::BoardBatch() {
+    count = 0;
+    capacity = 0;
+}
+
+void BoardBatch::Clear() {
+    count = 0;
+    capacity = 0;
+    squares.clear();
+    players.clear();
+}
+
+// 扩容时按新的容量重新排布各格子
+void BoardBatch::Reserve(size_t size) {
+    size_t newCapacity = (size + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES;
+    if (newCapacity <= capacity) return;
+    vector<uint8_t> newSquares((size_t)BOARD_HEIGHT * BOARD_WIDTH * newCapacity, 0);
+    for (int square = 0; square < BOARD_HEIGHT * BOARD_WIDTH; ++square) {
+        memcpy(newSquares.data() + square * newCapacity, squares.data() + square * capacity, count);
+    }
+    squares.swap(newSquares);
+    players.resize(newCapacity, 0);
+    capacity = newCapacity;
+}
+
+size_t BoardBatch::Add(const ChessBoard& board, Color player) {
+    if (count == capacity) Reserve(max((size_t)BATCH_LANES, capacity * 2));
+    for (int row = 0; row < BOARD_HEIGHT; ++row) {
+        for (int col = 0; col < BOARD_WIDTH; ++col) {
+            const ChessPiece* piece = board.GetPiece(row, col);
+            squares[(row * BOARD_WIDTH + col) * capacity + count] = piece->type == EMPTY ? 0 : piece->type | (piece->color << 4);
+        }
+    }
+    players[count] = player;
+    return count++;
+}
+
+size_t BoardBatch::Size() const {
+    return count;
+}
+
+const uint8_t* BoardBatch::Square(int square) const {
+    return squares.data() + square * capacity;
+}
+
+Color BoardBatch::Player(size_t index) const {
+    return (Color)players[index];
+}
+
+template <class Emit>
+void BoardBatch::ScanBlock(size_t begin, Emit& emit) const {
+    static const int STEPS[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    static const int DIAGONALS[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    static const int HORSE_STEPS[8][2] = {{1, 2}, {1, -2}, {-1, 2}, {-1, -2}, {2, 1}, {2, -1}, {-2, 1}, {-2, -1}};
+    const int SQUARES = BOARD_HEIGHT * BOARD_WIDTH;
+    auto inside = [](int row, int col) { return row >= 0 && row < BOARD_HEIGHT && col >= 0 && col < BOARD_WIDTH; };
+
+    // 预先计算各格子为空、非己方棋子的掩码
+    LaneMask player = LoadLanes(players.data() + begin);
+    LaneMask red = player == (int8_t)RED;
+    LaneMask black = player == (int8_t)BLACK;
+    LaneMask pieces[SQUARES], empty[SQUARES], notOwn[SQUARES];
+    for (int square = 0; square < SQUARES; ++square) {
+        pieces[square] = LoadLanes(Square(square) + begin);
+        empty[square] = pieces[square] == 0;
+        notOwn[square] = empty[square] | ((pieces[square] >> 4) != player);
+    }
+
+    for (int from = 0; from < SQUARES; ++from) {
+        LaneMask mine = ~notOwn[from];
+        if (!Any(mine)) continue;
+        int row = from / BOARD_WIDTH;
+        int col = from % BOARD_WIDTH;
+        LaneMask type = pieces[from] & 0xF;
+        auto tryMove = [&](int targetRow, int targetCol, LaneMask mask) {
+            if (!inside(targetRow, targetCol)) return;
+            int to = targetRow * BOARD_WIDTH + targetCol;
+            mask &= notOwn[to];
+            if (Any(mask)) emit(from, to, mask);
+        };
+
+        // 将帅与士：目标须在己方九宫
+        LaneMask king = mine & (type == (int8_t)KING);
+        LaneMask advisor = mine & (type == (int8_t)ADVISOR);
+        if (Any(king | advisor)) {
+            for (int i = 0; i < 4; ++i) {
+                int targetRow = row + STEPS[i][0], targetCol = col + STEPS[i][1];
+                LaneMask palace = targetCol < 3 || targetCol > 5 ? LaneMask{} : (targetRow <= 2 ? red : (targetRow >= 7 ? black : LaneMask{}));
+                tryMove(targetRow, targetCol, king & palace);
+                targetRow = row + DIAGONALS[i][0], targetCol = col + DIAGONALS[i][1];
+                palace = targetCol < 3 || targetCol > 5 ? LaneMask{} : (targetRow <= 2 ? red : (targetRow >= 7 ? black : LaneMask{}));
+                tryMove(targetRow, targetCol, advisor & palace);
+            }
+        }
+
+        // 象：象眼为空且不过河
+        LaneMask elephant = mine & (type == (int8_t)ELEPHANT);
+        if (Any(elephant)) {
+            for (const auto& step : DIAGONALS) {
+                int targetRow = row + 2 * step[0], targetCol = col + 2 * step[1];
+                if (!inside(targetRow, targetCol)) continue;
+                LaneMask side = targetRow <= 4 ? red : black;
+                tryMove(targetRow, targetCol, elephant & side & empty[(row + step[0]) * BOARD_WIDTH + col + step[1]]);
+            }
+        }
+
+        // 马：马腿为空
+        LaneMask horse = mine & (type == (int8_t)HORSE);
+        if (Any(horse)) {
+            for (const auto& step : HORSE_STEPS) {
+                int targetRow = row + step[0], targetCol = col + step[1];
+                if (!inside(targetRow, targetCol)) continue;
+                tryMove(targetRow, targetCol, horse & empty[(row + step[0] / 2) * BOARD_WIDTH + col + step[1] / 2]);
+            }
+        }
+
+        // 兵卒：向前一步，过河后可横走
+        LaneMask pawn = mine & (type == (int8_t)PAWN);
+        if (Any(pawn)) {
+            tryMove(row + 1, col, pawn & red);
+            tryMove(row - 1, col, pawn & black);
+            LaneMask sideways = pawn & (row >= 5 ? red : black);
+            tryMove(row, col - 1, sideways);
+            tryMove(row, col + 1, sideways);
+        }
+
+        // 车炮：沿四个方向逐格推进，各局面分别维护是否被阻挡
+        LaneMask rook = mine & (type == (int8_t)ROOK);
+        LaneMask cannon = mine & (type == (int8_t)CANNON);
+        if (Any(rook | cannon)) {
+            for (const auto& step : STEPS) {
+                LaneMask rookOpen = rook;
+                LaneMask cannonOpen = cannon;   // 尚未越过炮架
+                LaneMask cannonScreen = LaneMask{}; // 已越过炮架、等待吃子
+                for (int targetRow = row + step[0], targetCol = col + step[1]; inside(targetRow, targetCol);
+                     targetRow += step[0], targetCol += step[1]) {
+                    if (!Any(rookOpen | cannonOpen | cannonScreen)) break;
+                    int to = targetRow * BOARD_WIDTH + targetCol;
+                    LaneMask mask = (rookOpen & notOwn[to]) | (cannonOpen & empty[to]) | (cannonScreen & ~empty[to] & notOwn[to]);
+                    if (Any(mask)) emit(from, to, mask);
+                    rookOpen &= empty[to];
+                    cannonScreen &= empty[to];
+                    cannonScreen |= cannonOpen & ~empty[to];
+                    cannonOpen &= empty[to];
+                }
+            }
+        }
+    }
+}
+
+void BoardBatch::ParallelFor(size_t blocks, int threadNum, const function<void(size_t, size_t)>& body) {
+    if (threadNum <= 0) threadNum = max(1u, thread::hardware_concurrency());
+    threadNum = (int)min((size_t)threadNum, max((size_t)1, blocks));
+    if (threadNum == 1) {
+        body(0, blocks);
+        return;
+    }
+    vector<thread> threads;
+    size_t chunk = (blocks + threadNum - 1) / threadNum;
+    for (int i = 0; i < threadNum; ++i) {
+        size_t begin = i * chunk;
+        size_t end = min(blocks, begin + chunk);
+        if (begin >= end) break;
+        threads.push_back(thread(body, begin, end));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void BoardBatch::CountMoves(vector<uint32_t>& counts, int threadNum) const {
+    counts.assign(count, 0);
+    ParallelFor(capacity / BATCH_LANES, threadNum, [this, &counts](size_t first, size_t last) {
+        for (size_t block = first; block < last; ++block) {
+            size_t begin = block * BATCH_LANES;
+            LaneCount total = LaneCount{};
+            // 掩码为 -1，相减即计数
+            auto emit = [&total](int, int, LaneMask mask) { total -= __builtin_convertvector(mask, LaneCount); };
+            ScanBlock(begin, emit);
+            for (size_t lane = 0; lane < BATCH_LANES && begin + lane < count; ++lane) counts[begin + lane] = total[lane];
+        }
+    });
+}
+
+// 先统计走法数确定各局面的写入位置，再并行填充
+void BoardBatch::GenerateMoves(MoveBatch& out, int threadNum) const {
+    vector<uint32_t> counts;
+    CountMoves(counts, threadNum);
+    out.offsets.resize(count + 1);
+    out.offsets[0] = 0;
+    for (size_t i = 0; i < count; ++i) out.offsets[i + 1] = out.offsets[i] + counts[i];
+    out.moves.resize(out.offsets[count]);
+    ParallelFor(capacity / BATCH_LANES, threadNum, [this, &out](size_t first, size_t last) {
+        for (size_t block = first; block < last; ++block) {
+            size_t begin = block * BATCH_LANES;
+            uint32_t cursor[BATCH_LANES];
+            for (size_t lane = 0; lane < BATCH_LANES; ++lane) cursor[lane] = begin + lane < count ? out.offsets[begin + lane] : 0;
+            auto emit = [&cursor, &out](int from, int to, LaneMask mask) {
+                uint16_t code = from | (to << 7);
+                for (int lane = 0; lane < BATCH_LANES; ++lane) {
+                    if (mask[lane]) out.moves[cursor[lane]++] = code;
+                }
+            };
+            ScanBlock(begin, emit);
+        }
+    });
+}
\ No newline at end of file
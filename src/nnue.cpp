@@ -0,0 +1,281 @@
+#include "nnue.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <immintrin.h>
+#include "alphabeta.h"
+
+// 累加器更新：acc += sum(added) - sum(removed)
+typedef void (*UpdateKernel)(int16_t* acc, const int16_t* const* added, int addCount, const int16_t* const* removed, int removeCount);
+// 输出层：截断 ReLU 后与输出权重做点积
+typedef int32_t (*ForwardKernel)(const int16_t* us, const int16_t* them, const int16_t* weights);
+
+static void UpdateScalar(int16_t* acc, const int16_t* const* added, int addCount, const int16_t* const* removed, int removeCount) {
+    for (int i = 0; i < addCount; ++i) {
+        for (int h = 0; h < NNUE_HIDDEN; ++h) acc[h] += added[i][h];
+    }
+    for (int i = 0; i < removeCount; ++i) {
+        for (int h = 0; h < NNUE_HIDDEN; ++h) acc[h] -= removed[i][h];
+    }
+}
+
+static int32_t ForwardScalar(const int16_t* us, const int16_t* them, const int16_t* weights) {
+    int32_t sum = 0;
+    for (int h = 0; h < NNUE_HIDDEN; ++h) {
+        sum += min(max((int)us[h], 0), NNUE_CLIP) * weights[h];
+        sum += min(max((int)them[h], 0), NNUE_CLIP) * weights[NNUE_HIDDEN + h];
+    }
+    return sum;
+}
+
+// SSE4.1：整个累加器放入 16 个寄存器
+__attribute__((target("sse4.1")))
+static void UpdateSse41(int16_t* acc, const int16_t* const* added, int addCount, const int16_t* const* removed, int removeCount) {
+    const int lanes = NNUE_HIDDEN / 8;
+    __m128i regs[lanes];
+    for (int k = 0; k < lanes; ++k) regs[k] = _mm_loadu_si128((const __m128i*)(acc + k * 8));
+    for (int i = 0; i < addCount; ++i) {
+        for (int k = 0; k < lanes; ++k) regs[k] = _mm_add_epi16(regs[k], _mm_loadu_si128((const __m128i*)(added[i] + k * 8)));
+    }
+    for (int i = 0; i < removeCount; ++i) {
+        for (int k = 0; k < lanes; ++k) regs[k] = _mm_sub_epi16(regs[k], _mm_loadu_si128((const __m128i*)(removed[i] + k * 8)));
+    }
+    for (int k = 0; k < lanes; ++k) _mm_storeu_si128((__m128i*)(acc + k * 8), regs[k]);
+}
+
+__attribute__((target("sse4.1")))
+static int32_t ForwardSse41(const int16_t* us, const int16_t* them, const int16_t* weights) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i clip = _mm_set1_epi16(NNUE_CLIP);
+    __m128i sum = _mm_setzero_si128();
+    for (int h = 0; h < NNUE_HIDDEN; h += 8) {
+        __m128i x = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*)(us + h)), zero), clip);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(x, _mm_loadu_si128((const __m128i*)(weights + h))));
+        x = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*)(them + h)), zero), clip);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(x, _mm_loadu_si128((const __m128i*)(weights + NNUE_HIDDEN + h))));
+    }
+    sum = _mm_hadd_epi32(sum, sum);
+    sum = _mm_hadd_epi32(sum, sum);
+    return _mm_cvtsi128_si32(sum);
+}
+
+// AVX2：整个累加器放入 8 个寄存器
+__attribute__((target("avx2")))
+static void UpdateAvx2(int16_t* acc, const int16_t* const* added, int addCount, const int16_t* const* removed, int removeCount) {
+    const int lanes = NNUE_HIDDEN / 16;
+    __m256i regs[lanes];
+    for (int k = 0; k < lanes; ++k) regs[k] = _mm256_loadu_si256((const __m256i*)(acc + k * 16));
+    for (int i = 0; i < addCount; ++i) {
+        for (int k = 0; k < lanes; ++k) regs[k] = _mm256_add_epi16(regs[k], _mm256_loadu_si256((const __m256i*)(added[i] + k * 16)));
+    }
+    for (int i = 0; i < removeCount; ++i) {
+        for (int k = 0; k < lanes; ++k) regs[k] = _mm256_sub_epi16(regs[k], _mm256_loadu_si256((const __m256i*)(removed[i] + k * 16)));
+    }
+    for (int k = 0; k < lanes; ++k) _mm256_storeu_si256((__m256i*)(acc + k * 16), regs[k]);
+}
+
+__attribute__((target("avx2")))
+static int32_t ForwardAvx2(const int16_t* us, const int16_t* them, const int16_t* weights) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i clip = _mm256_set1_epi16(NNUE_CLIP);
+    __m256i sum = _mm256_setzero_si256();
+    for (int h = 0; h < NNUE_HIDDEN; h += 16) {
+        __m256i x = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(us + h)), zero), clip);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, _mm256_loadu_si256((const __m256i*)(weights + h))));
+        x = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(them + h)), zero), clip);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, _mm256_loadu_si256((const __m256i*)(weights + NNUE_HIDDEN + h))));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_hadd_epi32(half, half);
+    half = _mm_hadd_epi32(half, half);
+    return _mm_cvtsi128_si32(half);
+}
+
+static NNUESimd DetectSimd() {
+    if (__builtin_cpu_supports("avx2")) return NNUE_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return NNUE_SSE41;
+    return NNUE_SCALAR;
+}
+
+static NNUESimd activeSimd = DetectSimd();
+static UpdateKernel updateKernel = activeSimd == NNUE_AVX2 ? UpdateAvx2 : (activeSimd == NNUE_SSE41 ? UpdateSse41 : UpdateScalar);
+static ForwardKernel forwardKernel = activeSimd == NNUE_AVX2 ? ForwardAvx2 : (activeSimd == NNUE_SSE41 ? ForwardSse41 : ForwardScalar);
+
+NNUESimd NNUEEvaluator::GetSimd() {
+    return activeSimd;
+}
+
+bool NNUEEvaluator::IsSupported(NNUESimd simd) {
+    switch (simd) {
+        case NNUE_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case NNUE_SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        default:
+            return true;
+    }
+}
+
+bool NNUEEvaluator::SetSimd(NNUESimd simd) {
+    if (!IsSupported(simd)) return false;
+    activeSimd = simd;
+    updateKernel = simd == NNUE_AVX2 ? UpdateAvx2 : (simd == NNUE_SSE41 ? UpdateSse41 : UpdateScalar);
+    forwardKernel = simd == NNUE_AVX2 ? ForwardAvx2 : (simd == NNUE_SSE41 ? ForwardSse41 : ForwardScalar);
+    return true;
+}
+
+const char* NNUEEvaluator::SimdName(NNUESimd simd) {
+    switch (simd) {
+        case NNUE_AVX2:
+            return "AVX2";
+        case NNUE_SSE41:
+            return "SSE4.1";
+        default:
+            return "scalar";
+    }
+}
+
+NNUEEvaluator::NNUEEvaluator() {
+    Initialize();
+}
+
+void NNUEEvaluator::Initialize() {
+    featureWeights.assign((size_t)NNUE_FEATURES * NNUE_HIDDEN, 0);
+    featureBias.assign(NNUE_HIDDEN, 0);
+    outputWeights.assign(2 * NNUE_HIDDEN, 0);
+    outputBias = 0;
+    // 首个神经元累加己方子力位置分 / 4，与所在将帅位置无关
+    for (int bucket = 0; bucket < NNUE_BUCKETS; ++bucket) {
+        for (int type = KING; type <= PAWN; ++type) {
+            for (int row = 0; row < BOARD_HEIGHT; ++row) {
+                for (int col = 0; col < BOARD_WIDTH; ++col) {
+                    int index = (bucket * 14 + type - 1) * BOARD_HEIGHT * BOARD_WIDTH + row * BOARD_WIDTH + col;
+                    featureWeights[(size_t)index * NNUE_HIDDEN] = AlphaBetaAI::PieceValue((PieceType)type, row, col) / 4;
+                }
+            }
+        }
+    }
+    // 输出 = (己方 - 对方) * 16 / NNUE_OUTPUT_SCALE
+    outputWeights[0] = 16;
+    outputWeights[NNUE_HIDDEN] = -16;
+}
+
+bool NNUEEvaluator::Load(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) return false;
+    char magic[4];
+    int32_t header[2];
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in.good() || memcmp(magic, NNUE_FILE_MAGIC, 4) != 0 || header[0] != NNUE_FILE_VERSION || header[1] != NNUE_HIDDEN) return false;
+    in.read(reinterpret_cast<char*>(featureWeights.data()), featureWeights.size() * sizeof(int16_t));
+    in.read(reinterpret_cast<char*>(featureBias.data()), featureBias.size() * sizeof(int16_t));
+    in.read(reinterpret_cast<char*>(outputWeights.data()), outputWeights.size() * sizeof(int16_t));
+    in.read(reinterpret_cast<char*>(&outputBias), sizeof(outputBias));
+    if (!in.good()) {
+        Initialize();
+        return false;
+    }
+    return true;
+}
+
+bool NNUEEvaluator::Save(const string& path) const {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.is_open()) return false;
+    int32_t header[2] = {NNUE_FILE_VERSION, NNUE_HIDDEN};
+    out.write(NNUE_FILE_MAGIC, 4);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(featureWeights.data()), featureWeights.size() * sizeof(int16_t));
+    out.write(reinterpret_cast<const char*>(featureBias.data()), featureBias.size() * sizeof(int16_t));
+    out.write(reinterpret_cast<const char*>(outputWeights.data()), outputWeights.size() * sizeof(int16_t));
+    out.write(reinterpret_cast<const char*>(&outputBias), sizeof(outputBias));
+    return out.good();
+}
+
+int NNUEEvaluator::KingBucket(const ChessBoard& board, Color perspective) {
+    int rowBegin = perspective == RED ? 0 : BOARD_HEIGHT - 3;
+    for (int row = rowBegin; row < rowBegin + 3; ++row) {
+        for (int col = 3; col <= 5; ++col) {
+            const ChessPiece* piece = board.GetPiece(row, col);
+            if (piece->type == KING && piece->color == perspective) {
+                int relativeRow = perspective == RED ? row : BOARD_HEIGHT - 1 - row;
+                return relativeRow * 3 + col - 3;
+            }
+        }
+    }
+    return 0;
+}
+
+int NNUEEvaluator::FeatureIndex(Color perspective, int bucket, const ChessPiece& piece, int row, int col) {
+    if (perspective == BLACK) row = BOARD_HEIGHT - 1 - row;
+    int plane = (piece.color == perspective ? 0 : 7) + piece.type - 1;
+    return bucket * NNUE_PIECE_FEATURES + plane * BOARD_HEIGHT * BOARD_WIDTH + row * BOARD_WIDTH + col;
+}
+
+void NNUEEvaluator::RefreshPerspective(NNUEAccumulator& acc, const ChessBoard& board, Color perspective) const {
+    int side = perspective - 1;
+    int bucket = KingBucket(board, perspective);
+    const int16_t* added[32];
+    int addCount = 0;
+    for (int row = 0; row < BOARD_HEIGHT; ++row) {
+        for (int col = 0; col < BOARD_WIDTH; ++col) {
+            const ChessPiece* piece = board.GetPiece(row, col);
+            if (piece->type == EMPTY || addCount == 32) continue;
+            added[addCount++] = featureWeights.data() + (size_t)FeatureIndex(perspective, bucket, *piece, row, col) * NNUE_HIDDEN;
+        }
+    }
+    memcpy(acc.values[side], featureBias.data(), sizeof(acc.values[side]));
+    updateKernel(acc.values[side], added, addCount, nullptr, 0);
+    acc.kingBucket[side] = bucket;
+}
+
+void NNUEEvaluator::Refresh(NNUEAccumulator& acc, const ChessBoard& board) const {
+    RefreshPerspective(acc, board, RED);
+    RefreshPerspective(acc, board, BLACK);
+}
+
+void NNUEEvaluator::ApplyMove(NNUEAccumulator& acc, const ChessBoard& board, int fromRow, int fromCol, int toRow, int toCol,
+                              const ChessPiece& moved, const ChessPiece& captured) const {
+    for (Color perspective : {RED, BLACK}) {
+        int side = perspective - 1;
+        // 己方将帅移动后特征全部改变，重新计算该视角
+        if (moved.type == KING && moved.color == perspective) {
+            RefreshPerspective(acc, board, perspective);
+            continue;
+        }
+        int bucket = acc.kingBucket[side];
+        const int16_t* added[1] = {featureWeights.data() + (size_t)FeatureIndex(perspective, bucket, moved, toRow, toCol) * NNUE_HIDDEN};
+        const int16_t* removed[2] = {featureWeights.data() + (size_t)FeatureIndex(perspective, bucket, moved, fromRow, fromCol) * NNUE_HIDDEN};
+        int removeCount = 1;
+        if (captured.type != EMPTY) {
+            removed[removeCount++] = featureWeights.data() + (size_t)FeatureIndex(perspective, bucket, captured, toRow, toCol) * NNUE_HIDDEN;
+        }
+        updateKernel(acc.values[side], added, 1, removed, removeCount);
+    }
+}
+
+int NNUEEvaluator::Evaluate(const NNUEAccumulator& acc, Color player) const {
+    Color opponent = (player == RED) ? BLACK : RED;
+    return (forwardKernel(acc.values[player - 1], acc.values[opponent - 1], outputWeights.data()) + outputBias) / NNUE_OUTPUT_SCALE;
+}
+
+int NNUEEvaluator::Evaluate(const ChessBoard& board, Color player) const {
+    NNUEAccumulator acc;
+    Refresh(acc, board);
+    return Evaluate(acc, player);
+}
+
+float NNUEEvaluator::Value(const NNUEAccumulator& acc, Color player) const {
+    return tanh(Evaluate(acc, player) / NNUE_VALUE_SCALE);
+}
+
+void NNUEEvaluator::EvaluateBatch(EvalRequest* const* requests, int count) {
+    NNUEAccumulator acc;
+    for (int i = 0; i < count; ++i) {
+        EvalRequest* request = requests[i];
+        Refresh(acc, *request->board);
+        request->value = Value(acc, request->player);
+        size_t moveCount = request->moves->size();
+        request->priors.assign(moveCount, moveCount == 0 ? 0.0f : 1.0f / moveCount);
+    }
+}
\ No newline at end of file
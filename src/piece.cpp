@@ -1,17 +1,16 @@
 #include "piece.h"
+#include "tables.h"
 
 ChessBoard::ChessBoard(string name) {
     // cout << "ChessBoard constructor called" << endl;
     this->name = name;
     InitializeBoard();
-    InitializeSymbols();
 }
 
 ChessBoard::ChessBoard() {
     // cout << "ChessBoard constructor called" << endl;
     this->name = "ChessBoard";
     InitializeBoard();
-    InitializeSymbols();
 }
 
 ChessBoard::~ChessBoard() {
@@ -27,6 +26,7 @@ ChessBoard::~ChessBoard() {
 void ChessBoard::InitializeBoard() {
     // 初始化棋盘为 10 行 x 9 列
     board = vector<vector<ChessPiece>>(10, vector<ChessPiece>(9, ChessPiece{EMPTY, NONE, " "}));
+    hashKey = 0;
 
     // 初始化红方棋子
     SetPiece(0, 0, ROOK, RED);       // 俥
@@ -65,8 +65,16 @@ void ChessBoard::InitializeBoard() {
     SetPiece(6, 8, PAWN, BLACK);     // 卒
 }
 
+// 清空棋盘
+void ChessBoard::Clear() {
+    board = vector<vector<ChessPiece>>(10, vector<ChessPiece>(9, ChessPiece{EMPTY, NONE, " "}));
+    hashKey = 0;
+}
+
 // 设置棋子
 void ChessBoard::SetPiece(int row, int col, PieceType type, Color color) {
+    hashKey ^= ZobristKey(board[row][col].type, board[row][col].color, row, col);
+    hashKey ^= ZobristKey(type, color, row, col);
     board[row][col] = ChessPiece{type, color, GetSymbol(type, color)}; // 分配新对象
 }
 
@@ -75,17 +83,8 @@ const ChessPiece* ChessBoard::GetPiece(int row, int col) const{
 }
 
 // 获取棋子标识
-string ChessBoard::GetSymbol(PieceType type, Color color) {
-    static map<pair<Color, PieceType>, string> symbols = {
-        {{RED, KING},    "帥"}, {{BLACK, KING},    "將"},
-        {{RED, ADVISOR}, "仕"}, {{BLACK, ADVISOR}, "士"},
-        {{RED, ELEPHANT},"相"}, {{BLACK, ELEPHANT},"象"},
-        {{RED, HORSE},   "傌"}, {{BLACK, HORSE},   "馬"},
-        {{RED, ROOK},    "俥"}, {{BLACK, ROOK},    "車"},
-        {{RED, CANNON},  "炮"}, {{BLACK, CANNON},  "砲"},
-        {{RED, PAWN},    "兵"}, {{BLACK, PAWN},    "卒"}
-    };
-    return symbols[{color, type}];
+const char* ChessBoard::GetSymbol(PieceType type, Color color) {
+    return PIECE_SYMBOLS[color][type];
 }
 
 // 打印棋盘
@@ -112,7 +111,7 @@ void ChessBoard::Print(bool reverse) {
                     cout << " " << board[row][col].symbol << " ";
                 } else {
                     // 打印棋盘格子符号（固定宽度为 2 个字符）
-                    cout << " " << (positionSymbols[{row, col}] != " " ? positionSymbols[{row, col}] : "  ") << " ";
+                    cout << " " << SQUARE_SYMBOLS[row * BOARD_WIDTH + col] << " ";
                 }
                 if (col > 0) cout << "|"; // 列分隔符
             }
@@ -154,7 +153,7 @@ void ChessBoard::Print(bool reverse) {
                     cout << " " << board[row][col].symbol << " ";
                 } else {
                     // 打印棋盘格子符号（固定宽度为 2 个字符）
-                    cout << " " << (positionSymbols[{row, col}] != " " ? positionSymbols[{row, col}] : "  ") << " ";
+                    cout << " " << SQUARE_SYMBOLS[row * BOARD_WIDTH + col] << " ";
                 }
                 if (col < 8) cout << "|"; // 列分隔符
             }
@@ -189,91 +188,158 @@ bool ChessBoard::MovePiece(int fromRow, int fromCol, int toRow, int toCol) {
     // ChessPiece* target = board[toRow][toCol];
     // if (target) delete target;
     
+    MakeMove(fromRow, fromCol, toRow, toCol);
+    return true;
+}
+
+// 不检查合法性直接走子，返回被吃掉的棋子
+ChessPiece ChessBoard::MakeMove(int fromRow, int fromCol, int toRow, int toCol) {
+    ChessPiece captured = board[toRow][toCol];
+    hashKey ^= ZobristKey(captured.type, captured.color, toRow, toCol);
+    hashKey ^= ZobristKey(board[fromRow][fromCol].type, board[fromRow][fromCol].color, fromRow, fromCol);
+    hashKey ^= ZobristKey(board[fromRow][fromCol].type, board[fromRow][fromCol].color, toRow, toCol);
     board[toRow][toCol] = board[fromRow][fromCol];
     board[fromRow][fromCol] = ChessPiece{EMPTY, NONE, " "};
-    return true;
+    return captured;
+}
+
+// 撤销 MakeMove
+void ChessBoard::UnmakeMove(int fromRow, int fromCol, int toRow, int toCol, const ChessPiece& captured) {
+    hashKey ^= ZobristKey(board[toRow][toCol].type, board[toRow][toCol].color, toRow, toCol);
+    hashKey ^= ZobristKey(board[toRow][toCol].type, board[toRow][toCol].color, fromRow, fromCol);
+    hashKey ^= ZobristKey(captured.type, captured.color, toRow, toCol);
+    board[fromRow][fromCol] = board[toRow][toCol];
+    board[toRow][toCol] = captured;
+}
+
+// 判断是否被将军
+bool ChessBoard::IsInCheck(Color color) const {
+    int kingRow = -1, kingCol = -1;
+    for (int row = 0; row < 10 && kingRow < 0; ++row) {
+        for (int col = 3; col <= 5; ++col) {
+            if (board[row][col].type == KING && board[row][col].color == color) {
+                kingRow = row;
+                kingCol = col;
+                break;
+            }
+        }
+    }
+    if (kingRow < 0) return false;
+
+    for (int row = 0; row < 10; ++row) {
+        for (int col = 0; col < 9; ++col) {
+            const ChessPiece& piece = board[row][col];
+            if (piece.type == EMPTY || piece.color == color) continue;
+            if (piece.type == KING) {
+                // 将帅照面
+                if (col != kingCol) continue;
+                bool hasObstacle = false;
+                for (int r = min(row, kingRow) + 1; r < max(row, kingRow); ++r) {
+                    if (board[r][col].type != EMPTY) hasObstacle = true;
+                }
+                if (!hasObstacle) return true;
+            } else if (IsValidMove(row, col, kingRow, kingCol)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// 生成合法移动，直接遍历走法目标表与车炮射线表
+vector<pair<pair<int, int>, pair<int, int>>> ChessBoard::GenerateMoves(Color player) const {
+    vector<pair<pair<int, int>, pair<int, int>>> moves;
+    auto at = [this](int square) -> const ChessPiece& { return board[square / BOARD_WIDTH][square % BOARD_WIDTH]; };
+    auto push = [&moves](int from, int to) {
+        moves.push_back({{from / BOARD_WIDTH, from % BOARD_WIDTH}, {to / BOARD_WIDTH, to % BOARD_WIDTH}});
+    };
+    for (int from = 0; from < BOARD_SQUARES; ++from) {
+        const ChessPiece& piece = at(from);
+        if (piece.color != player) continue;
+        if (piece.type == ROOK || piece.type == CANNON) {
+            const RayTargets& rays = RAY_TABLE[from];
+            for (int dir = 0; dir < 4; ++dir) {
+                bool screened = false; // 炮已越过炮架
+                for (int i = 0; i < rays.length[dir]; ++i) {
+                    int to = rays.squares[dir][i];
+                    const ChessPiece& target = at(to);
+                    if (target.type == EMPTY) {
+                        if (!screened) push(from, to);
+                        continue;
+                    }
+                    if (piece.type == ROOK || screened) {
+                        if (target.color != player) push(from, to);
+                        break;
+                    }
+                    screened = true;
+                }
+            }
+            continue;
+        }
+        const StepTargets& targets = GetStepTargets(piece.type, player, from);
+        for (int i = 0; i < targets.count; ++i) {
+            if (targets.block[i] != NO_SQUARE && at(targets.block[i]).type != EMPTY) continue;
+            if (at(targets.to[i]).color != player) push(from, targets.to[i]);
+        }
+    }
+    return moves;
+}
+
+// Zobrist 随机数，使用固定种子生成，保证不同进程间哈希一致
+// 最后一个随机数表示黑方行棋
+const vector<uint64_t>& ChessBoard::ZobristTable() {
+    static const vector<uint64_t> keys = [] {
+        vector<uint64_t> table(2 * 7 * BOARD_HEIGHT * BOARD_WIDTH + 1);
+        uint64_t seed = 0x9E3779B97F4A7C15ULL;
+        for (auto& key : table) {
+            // splitmix64
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            key = z ^ (z >> 31);
+        }
+        return table;
+    }();
+    return keys;
+}
+
+uint64_t ChessBoard::ZobristKey(PieceType type, Color color, int row, int col) {
+    if (type == EMPTY || color == NONE) return 0;
+    return ZobristTable()[((color - 1) * 7 + (type - 1)) * BOARD_HEIGHT * BOARD_WIDTH + row * BOARD_WIDTH + col];
+}
+
+// 获取局面哈希
+uint64_t ChessBoard::GetHash(Color player) const {
+    return player == BLACK ? hashKey ^ ZobristTable().back() : hashKey;
 }
 
 // 移动验证（核心逻辑）
 bool ChessBoard::IsValidMove(int fromRow, int fromCol, int toRow, int toCol) const{
-    ChessPiece piece = board[fromRow][fromCol];
+    const ChessPiece& piece = board[fromRow][fromCol];
     if (piece.type == EMPTY) return false;
     if (fromRow == toRow && fromCol == toCol) return false;
     if (board[toRow][toCol].color == piece.color) return false;
-    
-
-    int dx = toCol - fromCol;
-    int dy = toRow - fromRow;
 
     switch (piece.type) {
-        case KING:
-            return ValidateKingMove(fromRow, fromCol, toRow, toCol, piece.color);
-        case HORSE:
-            return ValidateHorseMove(fromRow, fromCol, dx, dy);
-        case ADVISOR:
-            return ValidateAdvisorMove(fromRow, fromCol, toRow, toCol, piece.color);
-        case ELEPHANT:
-            return ValidateElephantMove(fromRow, fromCol, toRow, toCol, piece.color);
         case ROOK:
             return ValidateRookMove(fromRow, fromCol, toRow, toCol);
         case CANNON:
             return ValidateCannonMove(fromRow, fromCol, toRow, toCol);
-        case PAWN:
-            return ValidatePawnMove(fromRow, fromCol, toRow, toCol, piece.color);
         default:
-            return false;
+            return ValidateStepMove(fromRow, fromCol, toRow, toCol, piece.type, piece.color);
     }
 }
 
-// 将/帅移动规则
-bool ChessBoard::ValidateKingMove(int fromRow, int fromCol, int toRow, int toCol, Color color)  const{
-    // 移动范围限制
-    if (toCol < 3 || toCol > 5) return false;
-    if (color == RED && (toRow < 0 || toRow > 2)) return false;
-    if (color == BLACK && (toRow < 7 || toRow > 9)) return false;
-
-    // 移动步长限制
-    return (abs(toCol - fromCol) + abs(toRow - fromRow)) == 1;
-}
-
-// 马移动规则
-bool ChessBoard::ValidateHorseMove(int fromRow, int fromCol, int dx, int dy)  const{
-    // 马走日字
-    if (!((abs(dx) == 1 && abs(dy) == 2) || 
-    (abs(dx) == 2 && abs(dy) == 1))) return false;
-
-    // 检查蹩马腿
-    int blockRow = fromRow + dy/2;
-    int blockCol = fromCol + dx/2;
-    return board[blockRow][blockCol].type == EMPTY;
-}
-
-// 士移动规则
-bool ChessBoard::ValidateAdvisorMove(int fromRow, int fromCol, int toRow, int toCol, Color color)  const{
-    // 移动范围限制
-    if (toCol < 3 || toCol > 5) return false; // 士只能在九宫格内移动
-    if (color == RED && (toRow < 0 || toRow > 2)) return false; // 红方士只能在下方九宫格
-    if (color == BLACK && (toRow < 7 || toRow > 9)) return false; // 黑方士只能在上方九宫格
-
-    // 移动步长限制（只能斜走一步）
-    return abs(toCol - fromCol) == 1 && abs(toRow - fromRow) == 1;
-}
-
-// 象移动规则
-bool ChessBoard::ValidateElephantMove(int fromRow, int fromCol, int toRow, int toCol, Color color)  const{
-    // 移动步长限制（走田字）
-    if (abs(toCol - fromCol) != 2 || abs(toRow - fromRow) != 2) return false;
-
-    // 检查象眼是否被堵
-    int blockRow = fromRow + (toRow - fromRow) / 2;
-    int blockCol = fromCol + (toCol - fromCol) / 2;
-    if (board[blockRow][blockCol].type != EMPTY) return false;
-
-    // 不能过河
-    if (color == RED && toRow > 4) return false; // 红方象不能过河
-    if (color == BLACK && toRow < 5) return false; // 黑方象不能过河
-
-    return true;
+// 将帅、士、象、马、兵卒：终点须在走法目标表中，且马腿/象眼为空
+bool ChessBoard::ValidateStepMove(int fromRow, int fromCol, int toRow, int toCol, PieceType type, Color color) const {
+    const StepTargets& targets = GetStepTargets(type, color, fromRow * BOARD_WIDTH + fromCol);
+    int to = toRow * BOARD_WIDTH + toCol;
+    for (int i = 0; i < targets.count; ++i) {
+        if (targets.to[i] != to) continue;
+        int block = targets.block[i];
+        return block == NO_SQUARE || board[block / BOARD_WIDTH][block % BOARD_WIDTH].type == EMPTY;
+    }
+    return false;
 }
 
 // 车移动规则
@@ -317,7 +383,7 @@ bool ChessBoard::ValidateCannonMove(int fromRow, int fromCol, int toRow, int toC
     }
 
     // 炮的规则：移动时不能有障碍物，吃子时必须有一个障碍物
-    ChessPiece target = board[toRow][toCol];
+    const ChessPiece& target = board[toRow][toCol];
     if (target.type != EMPTY) { // 吃子
         return obstacleCount == 1;
     } else { // 移动
@@ -325,49 +391,6 @@ bool ChessBoard::ValidateCannonMove(int fromRow, int fromCol, int toRow, int toC
     }
 }
 
-// 兵/卒移动规则
-bool ChessBoard::ValidatePawnMove(int fromRow, int fromCol, int toRow, int toCol, Color color)  const{
-    int dx = toCol - fromCol;
-    int dy = toRow - fromRow;
-
-    if (color == RED) { // 红方兵
-        if (fromRow < 5) { // 未过河
-            if (dy != 1 || dx != 0) return false; // 只能向前走一步
-        } else { // 已过河
-            if (!((dy == 1 && dx == 0) || (dy == 0 && abs(dx) == 1))) return false; // 可以向前或左右走一步
-        }
-    } else { // 黑方卒
-        if (fromRow > 4) { // 未过河
-            if (dy != -1 || dx != 0) return false; // 只能向前走一步
-        } else { // 已过河
-            if (!((dy == -1 && dx == 0) || (dy == 0 && abs(dx) == 1))) return false; // 可以向前或左右走一步
-        }
-    }
-
-    return true;
-}
-
-// 初始化棋盘格子符号
-void ChessBoard::InitializeSymbols() {
-    for (int row = 0; row < 10; ++row) {
-        for (int col = 0; col < 9; ++col) {
-            // 河界
-            if (row == 4 || row == 5) {
-                positionSymbols[{row, col}] = "～"; // 使用波浪线表示河界
-            }
-            // 九宫格
-            else if ((row >= 0 && row <= 2 && col >= 3 && col <= 5) || 
-                     (row >= 7 && row <= 9 && col >= 3 && col <= 5)) {
-                positionSymbols[{row, col}] = "＋"; // 使用加号表示九宫格
-            }
-            // 其他格子
-            else {
-                positionSymbols[{row, col}] = " "; // 空格表示普通格子
-            }
-        }
-    }
-}
-
 GameResult ChessBoard::IsGameOver(const ChessBoard& board, Color currentPlayer) {
     bool redKingAlive = false, blackKingAlive = false;
     pair<int, int> redKingPos, blackKingPos;
@@ -403,7 +426,7 @@ GameResult ChessBoard::IsGameOver(const ChessBoard& board, Color currentPlayer)
         int startRow = min(redKingPos.first, blackKingPos.first) + 1;
         int endRow = max(redKingPos.first, blackKingPos.first);
         for (int row = startRow; row < endRow; ++row) {
-            if (board.GetPiece(row, redKingPos.second)) {
+            if (board.GetPiece(row, redKingPos.second)->type != EMPTY) {
                 hasObstacle = true;
                 break;
             }
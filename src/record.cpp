@@ -0,0 +1,308 @@
+#include "record.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 编码走法
+uint16_t EncodeMove(const pair<pair<int, int>, pair<int, int>>& move) {
+    uint16_t from = move.first.first * BOARD_WIDTH + move.first.second;
+    uint16_t to = move.second.first * BOARD_WIDTH + move.second.second;
+    return from | (to << 7);
+}
+
+// 解码走法
+pair<pair<int, int>, pair<int, int>> DecodeMove(uint16_t code) {
+    int from = code & 0x7F;
+    int to = (code >> 7) & 0x7F;
+    return {{from / BOARD_WIDTH, from % BOARD_WIDTH}, {to / BOARD_WIDTH, to % BOARD_WIDTH}};
+}
+
+// 检查走法编码
+bool IsValidMoveCode(uint16_t code) {
+    int from = code & 0x7F;
+    int to = (code >> 7) & 0x7F;
+    return (code >> 14) == 0 && from < BOARD_WIDTH * BOARD_HEIGHT && to < BOARD_WIDTH * BOARD_HEIGHT;
+}
+
+GameRecordWriter::GameRecordWriter() {
+    offset = 0;
+}
+
+GameRecordWriter::~GameRecordWriter() {
+    Close();
+}
+
+bool GameRecordWriter::Open(const string& path) {
+    Close();
+    out.open(path, ios::binary | ios::trunc);
+    if (!out.is_open()) return false;
+    offset = 0;
+    index.clear();
+
+    RecordFileHeader header;
+    memcpy(header.magic, RECORD_FILE_MAGIC, 4);
+    header.version = RECORD_FILE_VERSION;
+    header.reserved = 0;
+    WriteBytes(&header, sizeof(header));
+    return out.good();
+}
+
+// 关闭文件，写入索引与文件尾
+void GameRecordWriter::Close() {
+    if (!out.is_open()) return;
+    RecordFileFooter footer;
+    footer.indexOffset = offset;
+    footer.recordCount = index.size();
+    memcpy(footer.magic, RECORD_FOOTER_MAGIC, 4);
+    if (!index.empty()) WriteBytes(index.data(), index.size() * sizeof(uint64_t));
+    WriteBytes(&footer, sizeof(footer));
+    out.close();
+    index.clear();
+}
+
+bool GameRecordWriter::IsOpen() const {
+    return out.is_open();
+}
+
+void GameRecordWriter::WriteBytes(const void* data, size_t size) {
+    out.write(reinterpret_cast<const char*>(data), size);
+    offset += size;
+}
+
+void GameRecordWriter::BeginRecord(RecordType type, uint32_t size) {
+    index.push_back(offset);
+    RecordHeader header;
+    header.type = type;
+    header.reserved = 0;
+    header.reserved2 = 0;
+    header.size = size;
+    WriteBytes(&header, sizeof(header));
+}
+
+// 写入对局
+bool GameRecordWriter::WriteGame(const vector<pair<pair<int, int>, pair<int, int>>>& moves, GameResult result) {
+    if (!out.is_open() || moves.size() > UINT16_MAX) return false;
+    GameRecordHeader game;
+    game.result = result;
+    game.reserved = 0;
+    game.moveCount = moves.size();
+
+    vector<uint16_t> codes;
+    codes.reserve(moves.size());
+    for (const auto& move : moves) {
+        codes.push_back(EncodeMove(move));
+    }
+
+    BeginRecord(RECORD_GAME, sizeof(game) + codes.size() * sizeof(uint16_t));
+    WriteBytes(&game, sizeof(game));
+    if (!codes.empty()) WriteBytes(codes.data(), codes.size() * sizeof(uint16_t));
+    return out.good();
+}
+
+// 先序收集节点，已展开节点的子节点要么全部保存要么都不保存，
+// 保证重建后的节点不会缺少走法
+void GameRecordWriter::CollectNodes(MCTSNode* node, uint16_t move, int minVisits, int depth, vector<TreeNodeRecord>& nodes) {
+    size_t self = nodes.size();
+    TreeNodeRecord record;
+    record.move = move;
+    record.childCount = 0;
+    record.visits = node->VisitCount();
+    record.totalScore = node->TotalScore();
+    record.prior = node->Prior();
+    nodes.push_back(record);
+
+    if (depth <= 0 || node->IsLeaf() || node->VisitCount() < minVisits) return;
+    nodes[self].childCount = node->children.size();
+    for (auto child : node->children) {
+        CollectNodes(child, EncodeMove(child->GetLastMove()), minVisits, depth - 1, nodes);
+    }
+}
+
+// 写入搜索树
+bool GameRecordWriter::WriteTree(MCTSNode* root, int minVisits, int maxDepth) {
+    if (!out.is_open() || root == nullptr) return false;
+    vector<TreeNodeRecord> nodes;
+    CollectNodes(root, 0, minVisits, maxDepth, nodes);
+
+    TreeRecordHeader tree;
+    for (int row = 0; row < BOARD_HEIGHT; ++row) {
+        for (int col = 0; col < BOARD_WIDTH; ++col) {
+            const ChessPiece* piece = root->board.GetPiece(row, col);
+            tree.board[row * BOARD_WIDTH + col] = piece->type | (piece->color << 4);
+        }
+    }
+    tree.player = root->currentPlayer;
+    tree.reserved = 0;
+    tree.nodeCount = nodes.size();
+
+    BeginRecord(RECORD_TREE, sizeof(tree) + nodes.size() * sizeof(TreeNodeRecord));
+    WriteBytes(&tree, sizeof(tree));
+    WriteBytes(nodes.data(), nodes.size() * sizeof(TreeNodeRecord));
+    return out.good();
+}
+
+GameRecordFile::GameRecordFile() {
+    data = nullptr;
+    size = 0;
+    index = nullptr;
+    recordCount = 0;
+}
+
+GameRecordFile::~GameRecordFile() {
+    Close();
+}
+
+// 映射文件并校验文件头与索引
+bool GameRecordFile::Open(const string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)(sizeof(RecordFileHeader) + sizeof(RecordFileFooter))) {
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    data = static_cast<const uint8_t*>(mapped);
+    size = st.st_size;
+
+    const RecordFileHeader* header = reinterpret_cast<const RecordFileHeader*>(data);
+    const RecordFileFooter* footer = reinterpret_cast<const RecordFileFooter*>(data + size - sizeof(RecordFileFooter));
+    if (memcmp(header->magic, RECORD_FILE_MAGIC, 4) != 0 || header->version != RECORD_FILE_VERSION ||
+        memcmp(footer->magic, RECORD_FOOTER_MAGIC, 4) != 0 ||
+        footer->indexOffset + footer->recordCount * sizeof(uint64_t) + sizeof(RecordFileFooter) != size) {
+        Close();
+        return false;
+    }
+    index = reinterpret_cast<const uint64_t*>(data + footer->indexOffset);
+    recordCount = footer->recordCount;
+    return true;
+}
+
+void GameRecordFile::Close() {
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+    data = nullptr;
+    size = 0;
+    index = nullptr;
+    recordCount = 0;
+}
+
+size_t GameRecordFile::RecordCount() const {
+    return recordCount;
+}
+
+const RecordHeader* GameRecordFile::GetHeader(size_t i) const {
+    if (i >= recordCount) return nullptr;
+    uint64_t pos;
+    memcpy(&pos, index + i, sizeof(pos));
+    if (pos + sizeof(RecordHeader) > size) return nullptr;
+    const RecordHeader* header = reinterpret_cast<const RecordHeader*>(data + pos);
+    if (pos + sizeof(RecordHeader) + header->size > size) return nullptr;
+    return header;
+}
+
+RecordType GameRecordFile::GetType(size_t i) const {
+    const RecordHeader* header = GetHeader(i);
+    return header ? (RecordType)header->type : (RecordType)0;
+}
+
+bool GameRecordFile::GetGame(size_t i, GameRecordView& view) const {
+    const RecordHeader* header = GetHeader(i);
+    if (!header || header->type != RECORD_GAME || header->size < sizeof(GameRecordHeader)) return false;
+    const GameRecordHeader* game = reinterpret_cast<const GameRecordHeader*>(header + 1);
+    if (sizeof(GameRecordHeader) + game->moveCount * sizeof(uint16_t) > header->size) return false;
+    view.result = (GameResult)game->result;
+    view.moveCount = game->moveCount;
+    view.moves = reinterpret_cast<const uint16_t*>(game + 1);
+    return true;
+}
+
+bool GameRecordFile::ReadGame(size_t i, vector<pair<pair<int, int>, pair<int, int>>>& moves, GameResult& result) const {
+    GameRecordView view;
+    if (!GetGame(i, view)) return false;
+    moves.clear();
+    moves.reserve(view.moveCount);
+    for (uint16_t k = 0; k < view.moveCount; ++k) {
+        uint16_t code;
+        memcpy(&code, view.moves + k, sizeof(code));
+        moves.push_back(DecodeMove(code));
+    }
+    result = view.result;
+    return true;
+}
+
+// 已展开节点须保存全部合法走法，否则重建后的节点缺少的走法永远不会再被展开
+static bool IsCompleteChildCount(const MCTSNode* node, uint16_t childCount) {
+    return childCount == 0 || childCount == node->board.GenerateMoves(node->currentPlayer).size();
+}
+
+// 按先序重建节点，子节点统计量存放在父节点中，须先创建节点再写入统计量
+// 以显式栈代替递归，树的深度不受调用栈限制
+bool GameRecordFile::BuildTree(MCTSNode* root, const TreeNodeRecord* nodes, uint32_t nodeCount) {
+    vector<pair<MCTSNode*, uint16_t>> stack; // 节点与尚未重建的子节点数
+    if (!IsCompleteChildCount(root, nodes[0].childCount)) return false;
+    root->SetStats(nodes[0].visits, nodes[0].totalScore);
+    stack.push_back({root, nodes[0].childCount});
+    uint32_t pos = 1;
+    while (!stack.empty()) {
+        if (stack.back().second == 0) {
+            stack.pop_back();
+            continue;
+        }
+        if (pos >= nodeCount) return false;
+        stack.back().second--;
+        MCTSNode* node = stack.back().first;
+        const TreeNodeRecord& record = nodes[pos++];
+        if (!IsValidMoveCode(record.move)) return false;
+        if (find(node->stats.moves.begin(), node->stats.moves.end(), record.move) != node->stats.moves.end()) return false;
+        auto move = DecodeMove(record.move);
+        // 子节点走法必须是该节点行棋方的合法走法
+        if (node->board.GetPiece(move.first.first, move.first.second)->color != node->currentPlayer ||
+            !node->board.IsValidMove(move.first.first, move.first.second, move.second.first, move.second.second)) {
+            return false;
+        }
+        MCTSNode* child = node->AddChild(move, record.prior);
+        if (!IsCompleteChildCount(child, record.childCount)) return false;
+        child->SetStats(record.visits, record.totalScore);
+        stack.push_back({child, record.childCount});
+    }
+    return true;
+}
+
+// 加载搜索树
+bool GameRecordFile::LoadTree(size_t i, MCTSAI& ai) const {
+    const RecordHeader* header = GetHeader(i);
+    if (!header || header->type != RECORD_TREE || header->size < sizeof(TreeRecordHeader)) return false;
+    const TreeRecordHeader* tree = reinterpret_cast<const TreeRecordHeader*>(header + 1);
+    if (tree->nodeCount == 0 || sizeof(TreeRecordHeader) + (uint64_t)tree->nodeCount * sizeof(TreeNodeRecord) > header->size) return false;
+    if (tree->player != RED && tree->player != BLACK) return false;
+
+    ChessBoard board;
+    for (int row = 0; row < BOARD_HEIGHT; ++row) {
+        for (int col = 0; col < BOARD_WIDTH; ++col) {
+            uint8_t code = tree->board[row * BOARD_WIDTH + col];
+            if ((code & 0x0F) > PAWN || (code >> 4) > BLACK) return false;
+            board.SetPiece(row, col, (PieceType)(code & 0x0F), (Color)(code >> 4));
+        }
+    }
+    // 与当前对局局面不同的搜索树无法用于热启动
+    if (tree->player != ai.root->currentPlayer || board.GetHash((Color)tree->player) != ai.root->board.GetHash(ai.root->currentPlayer)) {
+        return false;
+    }
+
+    const TreeNodeRecord* nodes = reinterpret_cast<const TreeNodeRecord*>(tree + 1);
+    MCTSNode* root = new MCTSNode(board, (Color)tree->player);
+    if (!BuildTree(root, nodes, tree->nodeCount)) {
+        delete root;
+        return false;
+    }
+    delete ai.root;
+    ai.root = root;
+    ai.RecountNodes();
+    return true;
+}
@@ -0,0 +1,280 @@
+#include "server.h"
+#include <sstream>
+
+EngineServer::Session::Session(int id, const SessionConfig& config) : board(), ai(board, RED) {
+    this->id = id;
+    this->config = config;
+    player = RED;
+    searching = false;
+    closing = false;
+    issued = 0;
+    completed = 0;
+    running = 0;
+    pass = 0;
+    ai.SetNodeLimit(config.maxNodes);
+}
+
+EngineServer::EngineServer(int workerNum, SchedulePolicy policy, int sliceSize) {
+    this->policy = policy;
+    this->sliceSize = max(1, sliceSize);
+    stopping = false;
+    nextId = 1;
+    if (workerNum <= 0) workerNum = max(1u, thread::hardware_concurrency());
+    for (int i = 0; i < workerNum; ++i) {
+        workers.push_back(thread(&EngineServer::WorkerLoop, this));
+    }
+}
+
+EngineServer::~EngineServer() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int EngineServer::CreateSession(const SessionConfig& config) {
+    lock_guard<mutex> lock(mtx);
+    int id = nextId++;
+    sessions[id] = unique_ptr<Session>(new Session(id, config));
+    return id;
+}
+
+// 正在执行 slice 的会话由工作线程在结束后删除
+bool EngineServer::CloseSession(int id) {
+    lock_guard<mutex> lock(mtx);
+    auto it = sessions.find(id);
+    if (it == sessions.end() || it->second->closing) return false;
+    if (it->second->running > 0) it->second->closing = true;
+    else sessions.erase(it);
+    return true;
+}
+
+bool EngineServer::Play(int id, pair<pair<int, int>, pair<int, int>> move) {
+    lock_guard<mutex> lock(mtx);
+    auto it = sessions.find(id);
+    if (it == sessions.end() || it->second->closing || it->second->searching) return false;
+    Session& session = *it->second;
+    if (session.board.GetPiece(move.first.first, move.first.second)->color != session.player) return false;
+    if (!session.board.MovePiece(move.first.first, move.first.second, move.second.first, move.second.second)) return false;
+    session.ai.Update(move);
+    session.player = (session.player == RED) ? BLACK : RED;
+    return true;
+}
+
+bool EngineServer::Go(int id) {
+    {
+        lock_guard<mutex> lock(mtx);
+        auto it = sessions.find(id);
+        if (it == sessions.end() || it->second->closing || it->second->searching) return false;
+        Session& session = *it->second;
+        if (ChessBoard::IsGameOver(session.board, session.player) != NOT_OVER) return false;
+        session.searching = true;
+        session.issued = 0;
+        session.completed = 0;
+        session.deadline = chrono::steady_clock::now() + chrono::milliseconds(session.config.deadlineMs);
+        // 新加入调度的会话从当前最小累计值开始，避免补偿空闲期间的份额
+        double minPass = -1;
+        for (const auto& entry : sessions) {
+            const Session& other = *entry.second;
+            if (other.searching && &other != &session && (minPass < 0 || other.pass < minPass)) minPass = other.pass;
+        }
+        session.pass = max(0.0, minPass);
+    }
+    cv.notify_all();
+    return true;
+}
+
+void EngineServer::SetMoveCallback(function<void(int, pair<pair<int, int>, pair<int, int>>, GameResult)> callback) {
+    lock_guard<mutex> lock(mtx);
+    onMove = callback;
+}
+
+bool EngineServer::GetStats(int id, size_t& nodes, int& playouts, Color& player) const {
+    lock_guard<mutex> lock(mtx);
+    auto it = sessions.find(id);
+    if (it == sessions.end()) return false;
+    nodes = it->second->ai.GetNodeCount();
+    playouts = it->second->completed;
+    player = it->second->player;
+    return true;
+}
+
+vector<int> EngineServer::SessionIds() const {
+    lock_guard<mutex> lock(mtx);
+    vector<int> ids;
+    for (const auto& entry : sessions) ids.push_back(entry.first);
+    return ids;
+}
+
+bool EngineServer::HasBudget(const Session& session, chrono::steady_clock::time_point now) {
+    if (!session.searching || session.closing || session.issued >= session.config.playouts) return false;
+    // 截止时间到达后不再分配，但至少保证有一次模拟
+    return session.config.deadlineMs <= 0 || now < session.deadline || session.completed + session.running == 0;
+}
+
+EngineServer::Session* EngineServer::PickSession(chrono::steady_clock::time_point now) {
+    Session* best = nullptr;
+    for (auto& entry : sessions) {
+        Session* session = entry.second.get();
+        if (!HasBudget(*session, now)) continue;
+        if (best == nullptr) {
+            best = session;
+            continue;
+        }
+        if (policy == SCHEDULE_DEADLINE) {
+            // 有截止时间的会话优先，其余按累计值轮转
+            bool hasDeadline = session->config.deadlineMs > 0, bestHasDeadline = best->config.deadlineMs > 0;
+            if (hasDeadline != bestHasDeadline) {
+                if (hasDeadline) best = session;
+                continue;
+            }
+            if (hasDeadline && session->deadline != best->deadline) {
+                if (session->deadline < best->deadline) best = session;
+                continue;
+            }
+        }
+        if (session->pass < best->pass) best = session;
+    }
+    return best;
+}
+
+// 所有 slice 结束且预算用完（或超时）后选出最佳走法
+bool EngineServer::Finish(Session& session, pair<pair<int, int>, pair<int, int>>& move, GameResult& result) {
+    if (!session.searching || session.running > 0) return false;
+    if (HasBudget(session, chrono::steady_clock::now())) return false;
+    session.searching = false;
+    if (session.ai.root->IsLeaf()) session.ai.Run(1);
+    move = session.ai.GetBestMove();
+    session.board.MovePiece(move.first.first, move.first.second, move.second.first, move.second.second);
+    session.ai.Update(move);
+    session.player = (session.player == RED) ? BLACK : RED;
+    result = ChessBoard::IsGameOver(session.board, session.player);
+    return true;
+}
+
+void EngineServer::WorkerLoop() {
+    unique_lock<mutex> lock(mtx);
+    while (!stopping) {
+        auto now = chrono::steady_clock::now();
+        // 超时的会话由空闲线程结束
+        vector<tuple<int, pair<pair<int, int>, pair<int, int>>, GameResult>> finished;
+        for (auto& entry : sessions) {
+            pair<pair<int, int>, pair<int, int>> move;
+            GameResult result;
+            if (Finish(*entry.second, move, result)) finished.push_back(make_tuple(entry.first, move, result));
+        }
+        if (!finished.empty()) {
+            auto callback = onMove;
+            lock.unlock();
+            for (auto& item : finished) {
+                if (callback) callback(get<0>(item), get<1>(item), get<2>(item));
+            }
+            lock.lock();
+            continue;
+        }
+
+        Session* session = PickSession(now);
+        if (session == nullptr) {
+            cv.wait_for(lock, chrono::milliseconds(10));
+            continue;
+        }
+        int slice = min(sliceSize, session->config.playouts - session->issued);
+        int weight = policy == SCHEDULE_FAIR ? 1 : max(1, session->config.priority);
+        session->issued += slice;
+        session->running++;
+        session->pass += (double)slice / weight;
+        lock.unlock();
+        session->ai.Run(slice);
+        lock.lock();
+        session->running--;
+        session->completed += slice;
+        if (session->closing && session->running == 0) sessions.erase(session->id);
+    }
+}
+
+// 文本协议，每行一条命令，坐标格式与对局输入相同（如 b2 e2）：
+//   new [priority] [playouts] [deadlineMs] [maxNodes] -> session <id>
+//   play <id> <from> <to>                              -> ok | error
+//   go <id>                                            -> 完成后输出 bestmove <id> <from> <to> [result]
+//   stats                                              -> 每个会话一行
+//   close <id> / quit
+void EngineServer::Serve(istream& in, ostream& out, int playouts) {
+    mutex outMtx;
+    auto square = [](const pair<int, int>& pos) { return string(1, (char)('a' + pos.second)) + (char)('0' + pos.first); };
+    auto parse = [](const string& text, pair<int, int>& pos) {
+        if (text.size() != 2 || text[0] < 'a' || text[0] > 'i' || text[1] < '0' || text[1] > '9') return false;
+        pos = {text[1] - '0', text[0] - 'a'};
+        return true;
+    };
+    SetMoveCallback([&out, &outMtx, square](int id, pair<pair<int, int>, pair<int, int>> move, GameResult result) {
+        lock_guard<mutex> lock(outMtx);
+        out << "bestmove " << id << " " << square(move.first) << " " << square(move.second);
+        if (result == RED_WIN) out << " red";
+        else if (result == BLACK_WIN) out << " black";
+        else if (result == DRAW) out << " draw";
+        out << endl;
+    });
+
+    string line;
+    while (getline(in, line)) {
+        istringstream tokens(line);
+        string command;
+        if (!(tokens >> command)) continue;
+        string reply;
+        if (command == "new") {
+            SessionConfig config;
+            config.playouts = playouts;
+            tokens >> config.priority >> config.playouts >> config.deadlineMs >> config.maxNodes;
+            reply = "session " + to_string(CreateSession(config));
+        } else if (command == "play") {
+            int id = 0;
+            string from, to;
+            pair<pair<int, int>, pair<int, int>> move;
+            tokens >> id >> from >> to;
+            bool ok = parse(from, move.first) && parse(to, move.second) && Play(id, move);
+            reply = ok ? "ok" : "error";
+        } else if (command == "go") {
+            int id = 0;
+            tokens >> id;
+            if (!Go(id)) reply = "error";
+        } else if (command == "stats") {
+            ostringstream text;
+            for (int id : SessionIds()) {
+                size_t nodes;
+                int playouts;
+                Color player;
+                if (!GetStats(id, nodes, playouts, player)) continue;
+                text << "session " << id << " " << (player == RED ? "red" : "black") << " nodes " << nodes << " playouts " << playouts << "\n";
+            }
+            reply = text.str();
+            if (!reply.empty()) reply.pop_back();
+        } else if (command == "close") {
+            int id = 0;
+            tokens >> id;
+            reply = CloseSession(id) ? "ok" : "error";
+        } else if (command == "quit") {
+            break;
+        } else {
+            reply = "error";
+        }
+        if (!reply.empty()) {
+            lock_guard<mutex> lock(outMtx);
+            out << reply << endl;
+        }
+    }
+    // 等待进行中的搜索结束，回调引用的输出流在返回后失效
+    while (true) {
+        bool busy = false;
+        {
+            lock_guard<mutex> lock(mtx);
+            for (const auto& entry : sessions) busy |= entry.second->searching || entry.second->running > 0;
+        }
+        if (!busy) break;
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    SetMoveCallback(nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,460 @@
+#include "tablebase.h"
+#include <cstring>
+#include <fstream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char PIECE_LETTERS[] = " KAEHRCP";
+
+// 棋子可能出现的格子（仅依据棋子走法限制）
+static vector<int> PieceDomain(PieceType type, Color color) {
+    vector<int> squares;
+    for (int row = 0; row < BOARD_HEIGHT; ++row) {
+        for (int col = 0; col < BOARD_WIDTH; ++col) {
+            // 统一换算到红方视角
+            int r = (color == RED) ? row : BOARD_HEIGHT - 1 - row;
+            bool reachable = true;
+            switch (type) {
+                case KING:
+                    reachable = r <= 2 && col >= 3 && col <= 5;
+                    break;
+                case ADVISOR:
+                    reachable = r <= 2 && col >= 3 && col <= 5 && (r + col) % 2 == 1;
+                    break;
+                case ELEPHANT:
+                    reachable = (r == 0 || r == 4) ? (col == 2 || col == 6) : (r == 2 && col % 4 == 0);
+                    break;
+                case PAWN:
+                    reachable = r >= 5 || ((r == 3 || r == 4) && col % 2 == 0);
+                    break;
+                default:
+                    break;
+            }
+            if (reachable) squares.push_back(row * BOARD_WIDTH + col);
+        }
+    }
+    return squares;
+}
+
+EndgameTable::EndgameTable() {
+    entryCount = 0;
+    mappedData = nullptr;
+    mappedSize = 0;
+    values = nullptr;
+}
+
+EndgameTable::~EndgameTable() {
+    Close();
+}
+
+const string& EndgameTable::GetSignature() const {
+    return signature;
+}
+
+// 解析子力签名，第一个 K 之后为红方，第二个 K 之后为黑方
+bool EndgameTable::ParseSignature(const string& signature, vector<pair<PieceType, Color>>& pieces) {
+    pieces.clear();
+    if (signature.empty() || signature[0] != 'K') return false;
+    int kings = 0;
+    for (char c : signature) {
+        const char* pos = strchr(PIECE_LETTERS + 1, c);
+        if (pos == nullptr) return false;
+        PieceType type = (PieceType)(pos - PIECE_LETTERS);
+        if (type == KING) kings++;
+        if (kings > 2) return false;
+        pieces.push_back({type, kings == 1 ? RED : BLACK});
+    }
+    if (kings != 2 || pieces.size() > TABLEBASE_MAX_PIECES) return false;
+    sort(pieces.begin(), pieces.end(), [](const pair<PieceType, Color>& a, const pair<PieceType, Color>& b) {
+        return a.second != b.second ? a.second < b.second : a.first < b.first;
+    });
+    return true;
+}
+
+string EndgameTable::MakeSignature(const vector<pair<PieceType, Color>>& pieces) {
+    string signature;
+    for (const auto& piece : pieces) signature += PIECE_LETTERS[piece.first];
+    return signature;
+}
+
+void EndgameTable::Setup(const vector<pair<PieceType, Color>>& pieces) {
+    this->pieces = pieces;
+    signature = MakeSignature(pieces);
+    domains.clear();
+    squareIndex.clear();
+    entryCount = 2;
+    for (const auto& piece : pieces) {
+        domains.push_back(PieceDomain(piece.first, piece.second));
+        vector<int> index(BOARD_HEIGHT * BOARD_WIDTH, -1);
+        for (size_t i = 0; i < domains.back().size(); ++i) index[domains.back()[i]] = i;
+        squareIndex.push_back(index);
+        entryCount *= domains.back().size();
+    }
+}
+
+// 混合进制编码：每个棋子所在格子的序号，最低位为行棋方
+uint64_t EndgameTable::Index(const vector<int>& squares, Color player) const {
+    uint64_t index = 0;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        index = index * domains[i].size() + squareIndex[i][squares[i]];
+    }
+    return index * 2 + (player == BLACK ? 1 : 0);
+}
+
+void EndgameTable::Decode(uint64_t index, vector<int>& squares, Color& player) const {
+    player = (index & 1) ? BLACK : RED;
+    index >>= 1;
+    squares.resize(pieces.size());
+    for (size_t i = pieces.size(); i > 0; --i) {
+        squares[i - 1] = domains[i - 1][index % domains[i - 1].size()];
+        index /= domains[i - 1].size();
+    }
+}
+
+// 逆向分析：从终局局面出发按步数逐层回推
+bool EndgameTable::Generate(const string& signature, const EndgameTablebase& tablebase) {
+    vector<pair<PieceType, Color>> parsed;
+    if (!ParseSignature(signature, parsed)) return false;
+    Close();
+    Setup(parsed);
+
+    vector<int> dtm(entryCount, -1);        // 暂定步数，奇数为行棋方胜，偶数为负
+    vector<uint8_t> final(entryCount, 0);    // 是否已确定
+    vector<uint8_t> blocked(entryCount, 0);  // 存在吃子后和棋的走法，不可能判负
+    vector<uint16_t> remaining(entryCount, 0); // 尚未确定为对方胜的同表子局面数
+    vector<int> maxChild(entryCount, 0);     // 已知对方胜的子局面最大步数
+    vector<uint32_t> succStart(entryCount + 1, 0);
+    vector<uint32_t> succ;
+    vector<vector<uint32_t>> buckets(2);
+
+    auto propose = [&](uint64_t index, int steps) {
+        if (final[index] || (dtm[index] >= 0 && dtm[index] <= steps)) return;
+        dtm[index] = steps;
+        if ((int)buckets.size() <= steps) buckets.resize(steps + 1);
+        buckets[steps].push_back(index);
+    };
+
+    ChessBoard board;
+    vector<int> squares, childSquares;
+    Color player;
+    for (uint64_t index = 0; index < entryCount; ++index) {
+        succStart[index] = succ.size();
+        Decode(index, squares, player);
+
+        bool overlap = false;
+        for (size_t i = 0; i < squares.size() && !overlap; ++i) {
+            for (size_t j = i + 1; j < squares.size(); ++j) {
+                if (squares[i] == squares[j]) overlap = true;
+            }
+        }
+        if (overlap) {
+            final[index] = 1;
+            continue;
+        }
+
+        board.Clear();
+        for (size_t i = 0; i < pieces.size(); ++i) {
+            board.SetPiece(squares[i] / BOARD_WIDTH, squares[i] % BOARD_WIDTH, pieces[i].first, pieces[i].second);
+        }
+        Color opponent = (player == RED) ? BLACK : RED;
+
+        // 将帅照面，行棋方直接获胜
+        if (ChessBoard::IsGameOver(board, player) == (player == RED ? RED_WIN : BLACK_WIN)) {
+            propose(index, 1);
+            continue;
+        }
+
+        auto moves = board.GenerateMoves(player);
+        if (moves.empty()) {
+            // 困毙判负
+            propose(index, 0);
+            continue;
+        }
+        for (const auto& move : moves) {
+            int from = move.first.first * BOARD_WIDTH + move.first.second;
+            int to = move.second.first * BOARD_WIDTH + move.second.second;
+            const ChessPiece* target = board.GetPiece(move.second.first, move.second.second);
+            if (target->type == KING) {
+                propose(index, 1);
+            } else if (target->type != EMPTY) {
+                // 吃子后查询子表
+                ChessBoard child = board;
+                child.MovePiece(move.first.first, move.first.second, move.second.first, move.second.second);
+                TablebaseResult result;
+                if (tablebase.Probe(child, opponent, result) && result.wdl != 0) {
+                    if (result.wdl < 0) propose(index, result.dtm + 1);
+                    else maxChild[index] = max(maxChild[index], result.dtm);
+                } else {
+                    blocked[index] = 1;
+                }
+            } else {
+                childSquares = squares;
+                for (auto& square : childSquares) {
+                    if (square == from) square = to;
+                }
+                succ.push_back(Index(childSquares, opponent));
+                remaining[index]++;
+            }
+        }
+        if (remaining[index] == 0 && !blocked[index] && dtm[index] < 0) propose(index, maxChild[index] + 1);
+    }
+    succStart[entryCount] = succ.size();
+
+    // 建立前驱表
+    vector<uint32_t> predStart(entryCount + 1, 0);
+    for (uint32_t child : succ) predStart[child + 1]++;
+    for (uint64_t i = 0; i < entryCount; ++i) predStart[i + 1] += predStart[i];
+    vector<uint32_t> pred(succ.size());
+    vector<uint32_t> fill(predStart.begin(), predStart.end() - 1);
+    for (uint64_t index = 0; index < entryCount; ++index) {
+        for (uint32_t k = succStart[index]; k < succStart[index + 1]; ++k) {
+            pred[fill[succ[k]]++] = index;
+        }
+    }
+
+    // 按步数由小到大确定局面
+    for (size_t steps = 0; steps < buckets.size(); ++steps) {
+        for (size_t k = 0; k < buckets[steps].size(); ++k) {
+            uint32_t index = buckets[steps][k];
+            if (final[index] || dtm[index] != (int)steps) continue;
+            final[index] = 1;
+            for (uint32_t p = predStart[index]; p < predStart[index + 1]; ++p) {
+                uint32_t parent = pred[p];
+                if (final[parent]) continue;
+                if (steps % 2 == 0) {
+                    // 对方必负，前驱局面必胜
+                    propose(parent, steps + 1);
+                } else {
+                    // 对方必胜，前驱局面的所有走法都失败时判负
+                    maxChild[parent] = max(maxChild[parent], (int)steps);
+                    if (--remaining[parent] == 0 && !blocked[parent] && dtm[parent] < 0) {
+                        propose(parent, maxChild[parent] + 1);
+                    }
+                }
+            }
+        }
+    }
+
+    ownedValues.assign(entryCount, TABLEBASE_DRAW);
+    for (uint64_t index = 0; index < entryCount; ++index) {
+        Decode(index, squares, player);
+        bool overlap = false;
+        for (size_t i = 0; i < squares.size(); ++i) {
+            for (size_t j = i + 1; j < squares.size(); ++j) {
+                if (squares[i] == squares[j]) overlap = true;
+            }
+        }
+        if (overlap) ownedValues[index] = TABLEBASE_ILLEGAL;
+        else if (dtm[index] >= 0) {
+            // 超出一个字节的步数保留奇偶性截断
+            int steps = dtm[index] <= 253 ? dtm[index] : 253 - (dtm[index] % 2 == 0);
+            ownedValues[index] = steps + 1;
+        }
+    }
+    values = ownedValues.data();
+    return true;
+}
+
+bool EndgameTable::Write(const string& path) const {
+    if (!values) return false;
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.is_open()) return false;
+    TablebaseFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TABLEBASE_FILE_MAGIC, 4);
+    header.version = TABLEBASE_FILE_VERSION;
+    header.pieceCount = pieces.size();
+    for (size_t i = 0; i < pieces.size() && i < TABLEBASE_MAX_PIECES; ++i) {
+        header.pieces[i] = pieces[i].first | (pieces[i].second << 4);
+    }
+    header.entryCount = entryCount;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(values), entryCount);
+    return out.good();
+}
+
+// 映射残局表文件
+bool EndgameTable::Open(const string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(TablebaseFileHeader)) {
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    mappedData = static_cast<const uint8_t*>(mapped);
+    mappedSize = st.st_size;
+
+    const TablebaseFileHeader* header = reinterpret_cast<const TablebaseFileHeader*>(mappedData);
+    vector<pair<PieceType, Color>> parsed;
+    if (memcmp(header->magic, TABLEBASE_FILE_MAGIC, 4) == 0 && header->version == TABLEBASE_FILE_VERSION &&
+        header->pieceCount <= TABLEBASE_MAX_PIECES) {
+        for (int i = 0; i < header->pieceCount; ++i) {
+            parsed.push_back({(PieceType)(header->pieces[i] & 0x0F), (Color)(header->pieces[i] >> 4)});
+        }
+    }
+    vector<pair<PieceType, Color>> check;
+    if (parsed.empty() || !ParseSignature(MakeSignature(parsed), check) || check != parsed) {
+        Close();
+        return false;
+    }
+    Setup(parsed);
+    if (header->entryCount != entryCount || sizeof(TablebaseFileHeader) + entryCount > mappedSize) {
+        Close();
+        return false;
+    }
+    values = mappedData + sizeof(TablebaseFileHeader);
+    return true;
+}
+
+void EndgameTable::Close() {
+    if (mappedData) munmap(const_cast<uint8_t*>(mappedData), mappedSize);
+    mappedData = nullptr;
+    mappedSize = 0;
+    ownedValues.clear();
+    values = nullptr;
+}
+
+// 查询局面
+bool EndgameTable::Probe(const ChessBoard& board, Color player, bool mirror, TablebaseResult& result) const {
+    if (!values) return false;
+    vector<int> squares(pieces.size(), -1);
+    for (int row = 0; row < BOARD_HEIGHT; ++row) {
+        for (int col = 0; col < BOARD_WIDTH; ++col) {
+            const ChessPiece* piece = board.GetPiece(row, col);
+            if (piece->type == EMPTY) continue;
+            Color color = piece->color;
+            int square = row * BOARD_WIDTH + col;
+            if (mirror) {
+                color = (color == RED) ? BLACK : RED;
+                square = (BOARD_HEIGHT - 1 - row) * BOARD_WIDTH + col;
+            }
+            size_t slot = 0;
+            while (slot < pieces.size() && (squares[slot] >= 0 || pieces[slot].first != piece->type || pieces[slot].second != color)) slot++;
+            if (slot == pieces.size() || squareIndex[slot][square] < 0) return false;
+            squares[slot] = square;
+        }
+    }
+    for (int square : squares) {
+        if (square < 0) return false;
+    }
+    if (mirror) player = (player == RED) ? BLACK : RED;
+
+    uint8_t value = values[Index(squares, player)];
+    if (value == TABLEBASE_ILLEGAL) return false;
+    if (value == TABLEBASE_DRAW) {
+        result.wdl = 0;
+        result.dtm = 0;
+    } else {
+        result.dtm = value - 1;
+        result.wdl = (result.dtm % 2 == 1) ? 1 : -1;
+    }
+    return true;
+}
+
+EndgameTablebase::EndgameTablebase() {
+    maxPieces = 0;
+}
+
+EndgameTablebase::~EndgameTablebase() {
+    for (auto& item : tables) delete item.second;
+}
+
+void EndgameTablebase::AddTable(EndgameTable* table) {
+    auto it = tables.find(table->GetSignature());
+    if (it != tables.end()) delete it->second;
+    tables[table->GetSignature()] = table;
+    maxPieces = max(maxPieces, (int)table->GetSignature().size());
+}
+
+// 先生成所有少一个棋子的子表，再生成本表
+bool EndgameTablebase::Generate(const string& signature) {
+    vector<pair<PieceType, Color>> pieces;
+    if (!EndgameTable::ParseSignature(signature, pieces)) return false;
+    string canonical = EndgameTable::MakeSignature(pieces);
+    if (tables.count(canonical)) return true;
+
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (pieces[i].first == KING) continue;
+        vector<pair<PieceType, Color>> sub = pieces;
+        sub.erase(sub.begin() + i);
+        if (sub.size() > 2 && !Generate(EndgameTable::MakeSignature(sub))) return false;
+    }
+
+    EndgameTable* table = new EndgameTable();
+    if (!table->Generate(canonical, *this)) {
+        delete table;
+        return false;
+    }
+    AddTable(table);
+    return true;
+}
+
+bool EndgameTablebase::Save(const string& dir) const {
+    for (const auto& item : tables) {
+        if (!item.second->Write(dir + "/" + item.first + ".cctb")) return false;
+    }
+    return true;
+}
+
+// 加载目录下的残局表，返回加载数量
+int EndgameTablebase::Load(const string& dir) {
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) return 0;
+    int count = 0;
+    while (struct dirent* entry = readdir(handle)) {
+        string name = entry->d_name;
+        if (name.size() <= 5 || name.substr(name.size() - 5) != ".cctb") continue;
+        EndgameTable* table = new EndgameTable();
+        if (table->Open(dir + "/" + name)) {
+            AddTable(table);
+            count++;
+        } else {
+            delete table;
+        }
+    }
+    closedir(handle);
+    return count;
+}
+
+size_t EndgameTablebase::TableCount() const {
+    return tables.size();
+}
+
+int EndgameTablebase::MaxPieces() const {
+    return maxPieces;
+}
+
+// 根据棋盘上的子力选择残局表，必要时交换颜色查询
+bool EndgameTablebase::Probe(const ChessBoard& board, Color player, TablebaseResult& result) const {
+    if (tables.empty()) return false;
+    vector<pair<PieceType, Color>> pieces;
+    for (int row = 0; row < BOARD_HEIGHT; ++row) {
+        for (int col = 0; col < BOARD_WIDTH; ++col) {
+            const ChessPiece* piece = board.GetPiece(row, col);
+            if (piece->type == EMPTY) continue;
+            if ((int)pieces.size() >= maxPieces) return false;
+            pieces.push_back({piece->type, piece->color});
+        }
+    }
+    sort(pieces.begin(), pieces.end(), [](const pair<PieceType, Color>& a, const pair<PieceType, Color>& b) {
+        return a.second != b.second ? a.second < b.second : a.first < b.first;
+    });
+    auto it = tables.find(EndgameTable::MakeSignature(pieces));
+    if (it != tables.end()) return it->second->Probe(board, player, false, result);
+
+    for (auto& piece : pieces) piece.second = (piece.second == RED) ? BLACK : RED;
+    sort(pieces.begin(), pieces.end(), [](const pair<PieceType, Color>& a, const pair<PieceType, Color>& b) {
+        return a.second != b.second ? a.second < b.second : a.first < b.first;
+    });
+    it = tables.find(EndgameTable::MakeSignature(pieces));
+    if (it != tables.end()) return it->second->Probe(board, player, true, result);
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "timeman.h"
+#include <algorithm>
+
+#define TM_DEFAULT_MOVES 30    // 未指定步数时按剩余 30 步分配
+#define TM_MIN_ELAPSED 0.25    // 至少用去基础用时的该比例后才允许提前结束
+#define TM_DOMINANT_SHARE 0.75 // 最佳走法访问占比超过该值时提前结束
+#define TM_CLOSE_SHARE 0.1     // 最佳与次佳占比之差小于该值时延长用时
+#define TM_LATE_CHANGE 0.5     // 最佳走法在用去该比例的基础用时后改变时延长用时
+#define TM_EXTENSION 0.5       // 每项延长条件增加的基础用时比例
+
+TimeManager::TimeManager(int clockMs, int incrementMs, int movesToGo) {
+    start = chrono::steady_clock::now();
+    if (movesToGo <= 0) movesToGo = TM_DEFAULT_MOVES;
+    // 保留少量时间作为余量，避免超时
+    int reserve = min(clockMs / 20, 1000);
+    int usable = max(1, clockMs - reserve);
+    baseMs = min(usable, usable / movesToGo + incrementMs * 3 / 4);
+    maximumMs = min(usable, max(baseMs, min(baseMs * 3, usable / 3)));
+    baseMs = max(1, baseMs);
+    maximumMs = max(baseMs, maximumMs);
+    startVisits = 0;
+    lastChangeMs = 0;
+    started = false;
+}
+
+int TimeManager::BaseMs() const {
+    return baseMs;
+}
+
+int TimeManager::MaximumMs() const {
+    return maximumMs;
+}
+
+int TimeManager::ElapsedMs() const {
+    return (int)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+}
+
+bool TimeManager::ShouldContinue(const SearchSnapshot& snapshot) {
+    int elapsed = ElapsedMs();
+    if (!started) {
+        started = true;
+        startVisits = snapshot.visits;
+        lastBest = snapshot.bestMove;
+    }
+    if (snapshot.bestMove != lastBest) {
+        lastBest = snapshot.bestMove;
+        lastChangeMs = elapsed;
+    }
+    if (elapsed >= maximumMs) return false;
+
+    // 按根节点访问分布调整本步目标用时
+    double factor = 1;
+    if (snapshot.share - snapshot.secondShare < TM_CLOSE_SHARE) factor += TM_EXTENSION;
+    if (lastChangeMs > baseMs * TM_LATE_CHANGE) factor += TM_EXTENSION;
+    int targetMs = min(maximumMs, (int)(baseMs * factor));
+    if (elapsed >= targetMs) return false;
+    if (elapsed < baseMs * TM_MIN_ELAPSED) return true;
+
+    if (snapshot.share >= TM_DOMINANT_SHARE) return false;
+    // 按当前速度估计剩余模拟次数，次佳走法无法追上时提前结束
+    int searched = snapshot.visits - startVisits;
+    if (elapsed > 0 && searched > 0) {
+        double remaining = (double)searched / elapsed * (targetMs - elapsed);
+        double gap = (snapshot.share - snapshot.secondShare) * snapshot.visits;
+        if (gap > remaining) return false;
+    }
+    return true;
+}
\ No newline at end of file